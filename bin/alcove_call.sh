@@ -19,11 +19,67 @@ EOF
 
 PROTO=$1
 
-OIFS=$IFS
+# Map an argument type in the proto file to the C parameter types of
+# the call.
+ctype() {
+    case $1 in
+        void) ;;
+        int|constant:*|constant_list:*) printf ", int" ;;
+        uint) printf ", u_int32_t" ;;
+        long) printf ", long" ;;
+        ulong) printf ", unsigned long" ;;
+        longlong|constant64:*) printf ", long long" ;;
+        ulonglong) printf ", unsigned long long" ;;
+        iolist) printf ", const char *, size_t" ;;
+        iovec) printf ", const struct iovec *, int" ;;
+        path) printf ", const char *" ;;
+        argv) printf ", char **" ;;
+        cstruct|cstruct_persist)
+            printf ", char *, size_t, alcove_alloc_t *, ssize_t"
+            ;;
+        *) echo "unsupported type: $1" 1>&2; exit 1 ;;
+    esac
+}
+
 while read line; do
-    IFS=/
+    IFS=' '
     set -- $line
-    cat << EOF
+    call=$1
+    shift
+
+    IFS=/
+    set -- $call $*
+
+    if [ "$#" -eq 2 ]; then
+        cat << EOF
 ssize_t alcove_sys_$1(alcove_state_t *, const char *, size_t, char *, size_t);
 EOF
+        continue
+    fi
+
+    name=$1
+    shift 2
+    args=""
+    for t in "$@"; do
+        args="$args$(ctype $t)" || exit 1
+    done
+
+    cat << EOF
+ssize_t alcove_sys_$name(alcove_state_t *$args, char *, size_t);
+EOF
+done < $PROTO
+
+# call numbers: the index of the call in the proto file
+echo
+echo "enum {"
+n=0
+while read line; do
+    IFS=' '
+    set -- $line
+    IFS=/
+    set -- $1
+    printf "    ALCOVE_CALL_%s = %d,\n" $(echo $1 | tr a-z A-Z) $n
+    n=$((n+1))
 done < $PROTO
+printf "    ALCOVE_NCALL = %d\n" $n
+echo "};"
@@ -19,21 +19,236 @@ EOF
 
 PROTO=$1
 
+# Calls with argument types in the proto file are dispatched through a
+# generated decoder: the arguments are decoded in order and passed to
+# the call as C types.
+#
+#   kill/2 int constant:signal
+#
+#   ssize_t alcove_sys_kill(alcove_state_t *, int, int, char *, size_t);
+#
+# The list types are decoded in a single pass:
+#
+#   constant_list:T: a list of constants OR'ed into an int
+#   path: a non-empty, NUL terminated iolist of at most PATH_MAX bytes
+#   argv: a NULL terminated list of strings allocated from the arena
+#   cstruct: a buffer, the length of the buffer and the array of
+#     {ptr, ...} elements, allocated from the arena
+#   cstruct_persist: a cstruct with {ptr, ...} targets outliving the call
+
+# constant tables used by typed calls
+for table in $(tr ' ' '\n' < $PROTO | \
+        sed -n 's/^constant[a-z0-9_]*:\([a-z_]*\)$/\1/p' | sort -u); do
+    printf '#include "sys/alcove_%s_constants.h"\n' $table
+done
+
+# decl <n> <type>
+decl() {
+    case $2 in
+        int|constant:*|constant_list:*) printf "    int a%d = 0;\n" $1 ;;
+        uint) printf "    u_int32_t a%d = 0;\n" $1 ;;
+        long) printf "    long a%d = 0;\n" $1 ;;
+        ulong) printf "    unsigned long a%d = 0;\n" $1 ;;
+        longlong|constant64:*) printf "    long long a%d = 0;\n" $1 ;;
+        ulonglong) printf "    unsigned long long a%d = 0;\n" $1 ;;
+        iolist)
+            # not zeroed: only the decoded length is passed to the call
+            printf "    char a%d[MAXMSGLEN];\n" $1
+            printf "    size_t a%dlen = sizeof(a%d);\n" $1 $1
+            ;;
+        iovec)
+            printf "    struct iovec *a%d = NULL;\n" $1
+            printf "    int a%dcnt = 0;\n" $1
+            ;;
+        path)
+            printf "    char a%d[PATH_MAX] = {0};\n" $1
+            printf "    size_t a%dlen = sizeof(a%d)-1;\n" $1 $1
+            ;;
+        argv) printf "    char **a%d = NULL;\n" $1 ;;
+        cstruct|cstruct_persist)
+            printf "    char a%d[MAXMSGLEN];\n" $1
+            printf "    size_t a%dlen = sizeof(a%d);\n" $1 $1
+            printf "    alcove_alloc_t *a%delem = NULL;\n" $1
+            printf "    ssize_t a%dnelem = 0;\n" $1
+            ;;
+    esac
+}
+
+# decode <n> <type>
+decode() {
+    case $2 in
+        int|uint|long|ulong|longlong|ulonglong)
+            cat << EOF
+
+    if (alcove_decode_$2(arg, len, &index, &a$1) < 0)
+        return -1;
+EOF
+            ;;
+        constant:*|constant64:*)
+            fun=constant
+            [ "${2%%:*}" = "constant64" ] && fun=constant64
+            cat << EOF
+
+    switch (alcove_decode_$fun(arg, len, &index, &a$1,
+                alcove_${2#*:}_constants)) {
+        case 0:
+            break;
+        case 1:
+            return alcove_mk_error(reply, rlen, "enotsup");
+        default:
+            return -1;
+    }
+EOF
+            ;;
+        iolist)
+            cat << EOF
+
+    if (alcove_decode_iolist(arg, len, &index, a$1, &a${1}len) < 0)
+        return -1;
+EOF
+            ;;
+        constant_list:*)
+            cat << EOF
+
+    switch (alcove_decode_constant_list(arg, len, &index, &a$1,
+                alcove_${2#*:}_constants)) {
+        case 0:
+            break;
+        case 1:
+            return alcove_mk_error(reply, rlen, "enotsup");
+        default:
+            return -1;
+    }
+EOF
+            ;;
+        iovec)
+            cat << EOF
+
+    if (alcove_decode_iovec(arg, len, &index, &a$1, &a${1}cnt) < 0)
+        return -1;
+EOF
+            ;;
+        path)
+            cat << EOF
+
+    if (alcove_decode_iolist(arg, len, &index, a$1, &a${1}len) < 0 ||
+            a${1}len == 0)
+        return -1;
+EOF
+            ;;
+        argv)
+            cat << EOF
+
+    if (alcove_decode_argv(arg, len, &index, &a$1) < 0)
+        return -1;
+EOF
+            ;;
+        cstruct|cstruct_persist)
+            cat << EOF
+
+    if (alcove_decode_$2(arg, len, &index, a$1, &a${1}len,
+                &a${1}elem, &a${1}nelem) < 0)
+        return -1;
+EOF
+            ;;
+    esac
+}
+
+# param <n> <type>
+param() {
+    case $2 in
+        void) ;;
+        iolist) printf ", a%d, a%dlen" $1 $1 ;;
+        iovec) printf ", a%d, a%dcnt" $1 $1 ;;
+        cstruct|cstruct_persist)
+            printf ", a%d, a%dlen, a%delem, a%dnelem" $1 $1 $1 $1
+            ;;
+        *) printf ", a%d" $1 ;;
+    esac
+}
+
+while read line; do
+    IFS=' '
+    set -- $line
+    call=$1
+    shift
+
+    IFS=/
+    set -- $call $*
+    IFS=' '
+
+    [ "$#" -eq 2 ] && continue
+
+    name=$1
+    shift 2
+
+    printf "\n    static ssize_t\nalcove_args_%s(alcove_state_t *ap, const char *arg, size_t len,\n        char *reply, size_t rlen)\n{\n" $name
+
+    if [ "$1" = "void" ]; then
+        cat << EOF
+    UNUSED(arg);
+    UNUSED(len);
+
+    return alcove_sys_$name(ap, reply, rlen);
+}
+EOF
+        continue
+    fi
+
+    printf "    int index = 0;\n"
+
+    n=1
+    for t in "$@"; do
+        decl $n $t
+        n=$((n+1))
+    done
+
+    n=1
+    for t in "$@"; do
+        decode $n $t
+        n=$((n+1))
+    done
+
+    n=1
+    params=""
+    for t in "$@"; do
+        params="$params$(param $n $t)"
+        n=$((n+1))
+    done
+
+    cat << EOF
+
+    return alcove_sys_$name(ap$params, reply, rlen);
+}
+EOF
+done < $PROTO
+
 cat<< 'EOF'
 
 /* calls */
 typedef struct {
     ssize_t (*fp)(alcove_state_t *, const char *, size_t, char *, size_t);
     u_int8_t narg;
+    const char *name;
 } alcove_call_t;
 
 const alcove_call_t calls[] = {
 EOF
 
 while read line; do
-    IFS=/
+    IFS=' '
     set -- $line
-    printf "    {alcove_sys_%s, %s},\n" $1 $2
+    call=$1
+    shift
+
+    IFS=/
+    set -- $call $*
+
+    if [ "$#" -eq 2 ]; then
+        printf "    {alcove_sys_%s, %s, \"%s\"},\n" $1 $2 $1
+    else
+        printf "    {alcove_args_%s, %s, \"%s\"},\n" $1 $2 $1
+    fi
 done < $PROTO
 
 cat<< 'EOF'
@@ -13,6 +13,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 #include "alcove.h"
+#include "alcove_call.h"
 
 #include <sys/stat.h>
 
@@ -51,6 +52,9 @@ main(int argc, char *argv[])
     ap->maxfd = maxfd.rlim_cur;
     ap->fdsetsize = ALCOVE_MAXCHILD(ap->maxfd);
     ap->maxforkdepth = MAXFORKDEPTH;
+    ap->stdio[0] = ap->stdio[1] = ap->stdio[2] = -1;
+    ap->stdin_queue = ALCOVE_STDIN_QUEUE;
+    ap->fanout_timeout = ALCOVE_FANOUT_TIMEOUT;
 
     while ( (ch = getopt(argc, argv, "c:d:h")) != -1) {
         switch (ch) {
@@ -76,6 +80,14 @@ main(int argc, char *argv[])
     if (ap->child == NULL)
         exit(ENOMEM);
 
+    ap->watch = calloc(ap->maxfd, sizeof(u_int8_t));
+    if (ap->watch == NULL)
+        exit(ENOMEM);
+
+    ap->ncall = calloc(ALCOVE_NCALL, sizeof(u_int64_t));
+    if (ap->ncall == NULL)
+        exit(ENOMEM);
+
     if (boot) {
         if (alcove_signal_init() < 0)
             exit(errno);
@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/uio.h>
+#include <sys/stat.h>
 #include <stdbool.h>
 #include <sys/param.h>
 #include <sys/resource.h>
@@ -61,6 +62,9 @@
 #define MAXMSGLEN       UINT16_MAX
 #define MAXHDRLEN       8 /* 2 bytes length + 2 bytes type + 4 bytes PID */
 
+/* external term format: tag:1, length:4 */
+#define ALCOVE_BINARY_HDRLEN    5
+
 #define ALCOVE_MSGLEN(x,n) \
     ((n) - (((x) + 1) * MAXHDRLEN))
 
@@ -127,9 +131,59 @@ enum {
     alcove_opt_stdout_closed = 1 << 1, /* Report child stdout closed */
     alcove_opt_stderr_closed = 1 << 2, /* Report child stderr closed */
     alcove_opt_exit_status = 1 << 3,   /* Report child exit status */
-    alcove_opt_termsig = 1 << 4        /* Report child termination signal */
+    alcove_opt_termsig = 1 << 4,       /* Report child termination signal */
+    alcove_opt_offload = 1 << 5,       /* Run blocking calls in a thread */
+    alcove_opt_stdout_lines = 1 << 6,  /* Send whole lines of child stdout */
+    alcove_opt_exit_rusage = 1 << 7,   /* Report child resource usage */
+    alcove_opt_exit_batch = 1 << 8     /* Report child exits in one event */
+};
+
+/* Fields returned by stat calls: the values match STATX_* */
+enum {
+    ALCOVE_STAT_TYPE = 1 << 0,
+    ALCOVE_STAT_MODE = 1 << 1,
+    ALCOVE_STAT_NLINK = 1 << 2,
+    ALCOVE_STAT_UID = 1 << 3,
+    ALCOVE_STAT_GID = 1 << 4,
+    ALCOVE_STAT_ATIME = 1 << 5,
+    ALCOVE_STAT_MTIME = 1 << 6,
+    ALCOVE_STAT_CTIME = 1 << 7,
+    ALCOVE_STAT_INO = 1 << 8,
+    ALCOVE_STAT_SIZE = 1 << 9,
+    ALCOVE_STAT_BLOCKS = 1 << 10,
+    ALCOVE_STAT_ALL = (1 << 11) - 1
 };
 
+enum {
+    ALCOVE_MSG_STDIN = 0,
+    ALCOVE_MSG_STDOUT,
+    ALCOVE_MSG_STDERR,
+    ALCOVE_MSG_PROXY,
+    ALCOVE_MSG_CALL,
+    ALCOVE_MSG_EVENT,
+    ALCOVE_MSG_CTL,
+    ALCOVE_MSG_PIPE,
+    ALCOVE_MSG_RAWCALL,
+    ALCOVE_MSG_STDIN_SYNC,
+    ALCOVE_MSG_STDOUT_DEFLATE,
+    ALCOVE_MSG_STDERR_DEFLATE,
+};
+
+/* output shorter than this is not compressed */
+#define ALCOVE_COMPRESS_MIN 256
+
+/* Reply types for ALCOVE_MSG_RAWCALL:
+ *  |type:1|data:...|
+ */
+enum {
+    ALCOVE_RAW_ATOM = 0,    /* atom: name */
+    ALCOVE_RAW_INT64,       /* {ok, integer()}: native 64-bit integer */
+    ALCOVE_RAW_BINARY,      /* {ok, binary()}: data */
+    ALCOVE_RAW_ERROR        /* {error, atom()}: name */
+};
+
+#define ALCOVE_CHILD_EXEC -2
+
 enum {
     ALCOVE_SIGREAD_FILENO = 3,
     ALCOVE_SIGWRITE_FILENO,
@@ -139,6 +193,83 @@ enum {
 
 #define ALCOVE_MAXCHILD(_nfds) ((_nfds) / ALCOVE_MAXFILENO - ALCOVE_MAXFILENO)
 
+/* events for descriptors watched by the event loop */
+enum {
+    ALCOVE_WATCH_READ = 1 << 0,
+    ALCOVE_WATCH_WRITE = 1 << 1,
+    ALCOVE_WATCH_HUP = 1 << 2,
+    ALCOVE_WATCH_ONESHOT = 1 << 3,     /* removed after the first event */
+    ALCOVE_WATCH_DISARMED = 1 << 4     /* persistent: event sent */
+};
+
+/* delivery of caught signals: see sigevent/2 */
+enum {
+    ALCOVE_SIGEVENT_COALESCE = 1 << 0, /* one event per loop iteration */
+    ALCOVE_SIGEVENT_FIRST = 1 << 1,    /* report the first signal only */
+    ALCOVE_SIGEVENT_NOSIGINFO = 1 << 2, /* omit the siginfo_t */
+    ALCOVE_SIGEVENT_FIRED = 1 << 3     /* the first signal was reported */
+};
+
+#ifdef NSIG
+#define ALCOVE_NSIG NSIG
+#else
+#define ALCOVE_NSIG 65
+#endif
+
+typedef struct {
+    u_int8_t flags;
+    u_int32_t count;                    /* signals coalesced */
+    siginfo_t info;                     /* last signal coalesced */
+} alcove_sigevent_t;
+
+/* buffer size for each direction of a bridge */
+#define ALCOVE_BRIDGE_BUFSZ 65536
+
+enum {
+    ALCOVE_BRIDGE_IN_EOF = 1 << 0,     /* socket closed for reading */
+    ALCOVE_BRIDGE_OUT_EOF = 1 << 1,    /* child closed stdout */
+    ALCOVE_BRIDGE_OUT_SHUT = 1 << 2    /* socket shutdown for writing */
+};
+
+/* Relays data between a socket and the stdio of an exec'ed child */
+typedef struct {
+    int fd;
+    int flags;
+    u_int64_t in;                       /* bytes: socket -> stdin */
+    u_int64_t out;                      /* bytes: stdout -> socket */
+    size_t inlen;
+    size_t inoff;
+    size_t outlen;
+    size_t outoff;
+    char inbuf[ALCOVE_BRIDGE_BUFSZ];
+    char outbuf[ALCOVE_BRIDGE_BUFSZ];
+} alcove_bridge_t;
+
+/* data waiting to be written to the stdin of a child */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;                         /* end of queued data */
+    size_t off;                         /* start of queued data */
+    size_t *sync;                       /* end of each stdin_sync */
+    size_t nsync;
+    size_t maxsync;
+    int credit;                         /* data was refused */
+} alcove_stdinq_t;
+
+/* default limit for data queued to the stdin of a child */
+#define ALCOVE_STDIN_QUEUE  (4 * MAXMSGLEN)
+
+/* default ms to wait for the replies to fanout */
+#define ALCOVE_FANOUT_TIMEOUT   5000
+
+/* stdout of an exec'ed child held until a flush threshold is reached */
+typedef struct {
+    u_int64_t since;                    /* monotonic ms: oldest data */
+    size_t len;
+    char buf[MAXMSGLEN];
+} alcove_outbuf_t;
+
 typedef struct {
     pid_t pid;
     int exited;
@@ -146,8 +277,43 @@ typedef struct {
     int fdin;
     int fdout;
     int fderr;
+    alcove_bridge_t *bridge;
+    alcove_stdinq_t *stdinq;
+    alcove_outbuf_t *outbuf;
+    u_int64_t deadline;                 /* monotonic ms or 0 */
+    int deadline_sig;
+    u_int32_t discard;                  /* replies to calls timed out */
+    /* counters */
+    u_int64_t nout;                     /* bytes read from stdout */
+    u_int64_t nerr;                     /* bytes read from stderr */
+    u_int64_t nread;                    /* reads from stdout and stderr */
+    u_int64_t nthrottle;                /* passes ending at the budget */
+    u_int64_t nin;                      /* bytes written to stdin */
 } alcove_child_t;
 
+/* counters reported by stats/0 */
+typedef struct {
+    u_int64_t iterations;               /* event loop iterations */
+    u_int64_t wakeups;                  /* poll(2) returned events */
+    u_int64_t frames_in;                /* messages read from the port */
+    u_int64_t bytes_in;
+    u_int64_t frames_out;               /* messages written to the port */
+    u_int64_t bytes_out;
+    u_int64_t errors;                   /* calls returning an error */
+    u_int64_t eagain;                   /* writes to a full child stdin */
+    u_int64_t refused;                  /* bytes over the stdin_queue limit */
+    u_int64_t stdin_queue_hwm;          /* high water marks: bytes */
+    u_int64_t stdout_buffer_hwm;
+} alcove_stats_t;
+
+#define ALCOVE_MAXTIMER 64
+
+typedef struct {
+    u_int32_t id;                       /* 0: unused */
+    u_int64_t expires;                  /* monotonic ms */
+    u_int64_t interval;                 /* ms or 0 */
+} alcove_timer_t;
+
 typedef struct {
     int32_t opt;
     rlim_t maxfd;
@@ -155,7 +321,35 @@ typedef struct {
     u_int16_t maxforkdepth;
     u_int16_t fdsetsize;
     u_int16_t depth;
+    /* descriptors connected to stdio on exec or -1 */
+    int stdio[3];
     alcove_child_t *child;
+    /* watched descriptors: ALCOVE_WATCH_* flags indexed by fd */
+    u_int8_t *watch;
+    /* a call has run: re-arm persistent watches */
+    u_int8_t watch_rearm;
+    /* SIGCHLD caught while the worker is waiting for a child */
+    u_int8_t reap;
+    u_int32_t timerid;
+    alcove_timer_t timer[ALCOVE_MAXTIMER];
+    /* bytes read from the output of an exec'ed child per iteration */
+    u_int32_t read_budget;
+    /* child serviced first by the event loop */
+    u_int16_t rrindex;
+    /* bytes queued to the stdin of each child */
+    u_int32_t stdin_queue;
+    /* ms to wait for the replies to fanout: 0 waits indefinitely */
+    u_int32_t fanout_timeout;
+    /* aggregate the stdout of exec'ed children: 0 disables */
+    u_int32_t stdout_flush_bytes;
+    u_int32_t stdout_flush_ms;
+    /* zlib level for the output of exec'ed children: 0 disables */
+    int compress;
+    /* delivery mode of caught signals indexed by signal number */
+    alcove_sigevent_t sigevent[ALCOVE_NSIG];
+    alcove_stats_t stats;
+    /* number of times each call has run, indexed by call */
+    u_int64_t *ncall;
 } alcove_state_t;
 
 typedef struct {
@@ -168,10 +362,56 @@ typedef struct {
     size_t len;
 } alcove_alloc_t;
 
+typedef struct {
+    char *reply;
+    size_t rlen;
+    int rindex;
+} alcove_batch_t;
+
 void alcove_sig_info(int sig, siginfo_t *info, void *context);
 
 void alcove_event_init(alcove_state_t *ap);
 void alcove_event_loop(alcove_state_t *ap);
+int alcove_child_stdin(alcove_state_t *ap, alcove_child_t *c,
+        char *buf, size_t len);
+ssize_t alcove_child_call(alcove_state_t *ap, alcove_child_t *c,
+        char *buf, size_t len, u_int64_t deadline);
+ssize_t alcove_call_reply(u_int16_t type, char *buf, size_t len);
+const char *alcove_call_name(u_int32_t call);
+int alcove_call_error(u_int16_t type, const char *reply, size_t rlen);
+int alcove_child_flush(alcove_state_t *ap, alcove_child_t *c, int all);
+
+/* call read from stdin while the worker is busy */
+typedef struct alcove_offload_msg {
+    struct alcove_offload_msg *next;
+    u_int16_t type;
+    u_int16_t len;
+    unsigned char buf[];
+} alcove_offload_msg_t;
+
+int alcove_offload_call(alcove_state_t *ap, u_int16_t type, u_int16_t call,
+        const char *arg, size_t len);
+int alcove_offload_fd(void);
+int alcove_offload_pipe(int fd);
+int alcove_offload_busy(void);
+int alcove_offload_waitpid(void);
+int alcove_offload_self(void);
+void alcove_offload_exited(pid_t pid);
+int alcove_offload_queued(void);
+int alcove_offload_enqueue(u_int16_t type, const unsigned char *buf,
+        u_int16_t len);
+alcove_offload_msg_t *alcove_offload_dequeue(void);
+int alcove_offload_reply(void);
+void alcove_offload_reset(void);
+int alcove_waitpid_remove(alcove_state_t *ap, pid_t pid);
+
+u_int64_t alcove_timer_now(void);
+int alcove_timer_timeout(alcove_state_t *ap);
+int alcove_timer_expire(alcove_state_t *ap);
+
+int alcove_batch_init(alcove_batch_t *b, char *reply, size_t rlen);
+int alcove_batch_reserve(alcove_batch_t *b, size_t n);
+ssize_t alcove_batch_reply(alcove_batch_t *b);
 
 int pid_foreach(alcove_state_t *ap, pid_t pid, void *arg1, void *arg2,
         int (*comp)(pid_t, pid_t),
@@ -181,6 +421,9 @@ int pid_not_equal(pid_t p1, pid_t p2);
 
 ssize_t alcove_signal_name(char *, size_t, int *, int);
 int alcove_setfd(int, int);
+ssize_t alcove_copy(int, off_t *, int, off_t *, size_t);
+ssize_t alcove_sendfile(int, int, off_t *, size_t);
+ssize_t alcove_copy_rw(int, off_t *, int, off_t *, size_t);
 
 int alcove_get_type(const char *, size_t, const int *, int *, int *);
 int alcove_decode_binary(const char *, size_t, int *, void *, size_t *);
@@ -195,6 +438,8 @@ int alcove_decode_string(const char *, size_t, int *, char *, size_t);
 int alcove_decode_list_header(const char *, size_t, int *, int *);
 int alcove_decode_tuple_header(const char *, size_t, int *, int *);
 int alcove_decode_iolist(const char *, size_t, int *, char *, size_t *);
+int alcove_decode_iovec(const char *, size_t, int *, struct iovec **,
+        int *);
 int alcove_decode_constant(const char *, size_t, int *, int *,
         const alcove_constant_t *);
 int alcove_decode_constant_list(const char *, size_t, int *, int *,
@@ -203,8 +448,14 @@ int alcove_decode_constant64(const char *buf, size_t len, int *index,
         long long *val, const alcove_constant_t *constants);
 int alcove_decode_cstruct(const char *, size_t, int *, char *, size_t *,
         alcove_alloc_t **, ssize_t *);
+int alcove_decode_cstruct_persist(const char *, size_t, int *, char *,
+        size_t *, alcove_alloc_t **, ssize_t *);
 int alcove_decode_argv(const char *, size_t, int *, char ***);
-void alcove_free_argv(char **);
+
+void *alcove_arena_reserve(size_t);
+void *alcove_arena_alloc(size_t);
+void *alcove_arena_calloc(size_t, size_t);
+void alcove_arena_reset(void);
 
 int alcove_encode_version(char *, size_t, int *);
 int alcove_encode_list_header(char *, size_t, int *, int);
@@ -216,13 +467,17 @@ int alcove_encode_longlong(char *, size_t, int *, long long);
 int alcove_encode_ulonglong(char *, size_t, int *, unsigned long long);
 int alcove_encode_atom(char *, size_t, int *, const char *);
 int alcove_encode_binary(char *, size_t, int *, const void *, long);
+int alcove_encode_binary_header(char *, size_t, int *, long);
 int alcove_encode_constant(char *, size_t, int *, char *,
         const alcove_constant_t *);
 int alcove_lookup_constant(char *, long long *, const alcove_constant_t *);
+const char *alcove_lookup_constant_id(long long, const alcove_constant_t *);
 int alcove_encode_constant_id(char *, size_t, int *, long long,
         const alcove_constant_t *);
 int alcove_encode_cstruct(char *, size_t, int *, const char *, size_t,
         alcove_alloc_t *, ssize_t);
+int alcove_encode_stat(char *, size_t, int *, const struct stat *,
+        unsigned int);
 
 ssize_t alcove_mk_errno(char *buf, size_t len, int errnum);
 ssize_t alcove_mk_error(char *buf, size_t len, const char *reason);
@@ -233,6 +488,17 @@ ssize_t alcove_mk_ulong(char *, size_t, unsigned long);
 
 ssize_t alcove_call(alcove_state_t *ap, u_int32_t call,
         const char *arg, size_t len, char *reply, size_t rlen);
+ssize_t alcove_rawcall(alcove_state_t *ap, u_int32_t call,
+        const char *arg, size_t len, char *reply, size_t rlen);
+
+ssize_t alcove_raw_atom(char *buf, size_t len, const char *atom);
+ssize_t alcove_raw_errno(char *buf, size_t len, int errnum);
+ssize_t alcove_raw_int64(char *buf, size_t len, int64_t val);
+
+ssize_t alcove_raw_read(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen);
+ssize_t alcove_raw_write(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen);
 
 char *erl_errno_id(int error);
 
@@ -0,0 +1,131 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+
+/*
+ * Per-call arena
+ *
+ * Memory allocated while decoding the arguments of a call is taken from
+ * a bump pointer arena. The arena is reset by alcove_call() when the
+ * call returns.
+ *
+ * The first chunk is kept across resets so a process running calls in
+ * a loop does not grow: larger chunks are returned to the system.
+ *
+ * Allocations that must outlive the call should use malloc(3).
+ */
+#define ALCOVE_ARENA_CHUNK  (2 * (MAXMSGLEN + 1))
+#define ALCOVE_ARENA_ALIGN  16
+
+typedef struct alcove_arena_chunk {
+    struct alcove_arena_chunk *next;
+    size_t size;
+    size_t used;
+    /* aligned for any type */
+    union {
+        long double ld;
+        long long ll;
+        void *p;
+    } data[];
+} alcove_arena_chunk_t;
+
+static alcove_arena_chunk_t *alcove_arena = NULL;
+
+static alcove_arena_chunk_t *alcove_arena_chunk(size_t size);
+
+    void *
+alcove_arena_reserve(size_t size)
+{
+    alcove_arena_chunk_t *c = NULL;
+
+    if (size >= INT32_MAX)
+        exit(ENOMEM);
+
+    size = (size + ALCOVE_ARENA_ALIGN - 1) & ~(ALCOVE_ARENA_ALIGN - 1);
+
+    if (alcove_arena == NULL)
+        alcove_arena = alcove_arena_chunk(ALCOVE_ARENA_CHUNK);
+
+    if (alcove_arena->size - alcove_arena->used < size) {
+        c = alcove_arena_chunk(MAX(size, ALCOVE_ARENA_CHUNK));
+        c->next = alcove_arena;
+        alcove_arena = c;
+    }
+
+    return (char *)alcove_arena->data + alcove_arena->used;
+}
+
+/* Allocate from the current chunk. An allocation following a call to
+ * alcove_arena_reserve() of the same or a greater size returns the
+ * reserved space. */
+    void *
+alcove_arena_alloc(size_t size)
+{
+    void *p = alcove_arena_reserve(size);
+
+    alcove_arena->used +=
+        (size + ALCOVE_ARENA_ALIGN - 1) & ~(ALCOVE_ARENA_ALIGN - 1);
+
+    return p;
+}
+
+    void *
+alcove_arena_calloc(size_t nmemb, size_t size)
+{
+    void *p = NULL;
+
+    if (size > 0 && nmemb > INT32_MAX / size)
+        exit(ENOMEM);
+
+    p = alcove_arena_alloc(nmemb * size);
+    (void)memset(p, 0, nmemb * size);
+
+    return p;
+}
+
+    void
+alcove_arena_reset(void)
+{
+    alcove_arena_chunk_t *c = alcove_arena;
+
+    if (c == NULL)
+        return;
+
+    /* the first chunk is at the end of the list */
+    while (c->next != NULL) {
+        alcove_arena_chunk_t *next = c->next;
+        free(c);
+        c = next;
+    }
+
+    c->used = 0;
+    alcove_arena = c;
+}
+
+    static alcove_arena_chunk_t *
+alcove_arena_chunk(size_t size)
+{
+    alcove_arena_chunk_t *c = NULL;
+
+    c = malloc(sizeof(alcove_arena_chunk_t) + size);
+    if (c == NULL)
+        exit(ENOMEM);
+
+    c->next = NULL;
+    c->size = size;
+    c->used = 0;
+
+    return c;
+}
@@ -0,0 +1,96 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+
+/*
+ * Batched replies
+ *
+ * A call returning a list larger than a message sends the list in
+ * batches:
+ *
+ *  {alcove_more, [...]}, ..., {ok, [...]}
+ *
+ * The list elements are encoded after space reserved for the reply
+ * header. The header is written before the elements when the batch
+ * is sent.
+ */
+
+/* {alcove_more, */
+#define ALCOVE_BATCH_HDRLEN 32
+
+static int alcove_batch_header(alcove_batch_t *b, const char *tag);
+
+    int
+alcove_batch_init(alcove_batch_t *b, char *reply, size_t rlen)
+{
+    if (rlen < ALCOVE_BATCH_HDRLEN + 1)
+        return -1;
+
+    b->reply = reply;
+    b->rlen = rlen;
+    b->rindex = ALCOVE_BATCH_HDRLEN;
+
+    return 0;
+}
+
+/* Reserve space for an element: the batch is sent if the element does
+ * not fit. Returns -1 if the element is larger than a message. */
+    int
+alcove_batch_reserve(alcove_batch_t *b, size_t n)
+{
+    int off = 0;
+
+    /* list tail */
+    if (b->rindex + n + 1 <= b->rlen)
+        return 0;
+
+    off = alcove_batch_header(b, "alcove_more");
+
+    if (alcove_call_reply(ALCOVE_MSG_CALL, b->reply + off,
+                b->rindex - off) < 0)
+        exit(errno);
+
+    b->rindex = ALCOVE_BATCH_HDRLEN;
+
+    return (b->rindex + n + 1 <= b->rlen) ? 0 : -1;
+}
+
+/* The final batch is returned as the call reply */
+    ssize_t
+alcove_batch_reply(alcove_batch_t *b)
+{
+    int off = alcove_batch_header(b, "ok");
+
+    (void)memmove(b->reply, b->reply + off, b->rindex - off);
+
+    return b->rindex - off;
+}
+
+    static int
+alcove_batch_header(alcove_batch_t *b, const char *tag)
+{
+    char hdr[ALCOVE_BATCH_HDRLEN] = {0};
+    int hlen = 0;
+
+    ALCOVE_ERR(alcove_encode_empty_list(b->reply, b->rlen, &b->rindex));
+
+    ALCOVE_ERR(alcove_encode_version(hdr, sizeof(hdr), &hlen));
+    ALCOVE_ERR(alcove_encode_tuple_header(hdr, sizeof(hdr), &hlen, 2));
+    ALCOVE_ERR(alcove_encode_atom(hdr, sizeof(hdr), &hlen, tag));
+
+    (void)memcpy(b->reply + ALCOVE_BATCH_HDRLEN - hlen, hdr, hlen);
+
+    return ALCOVE_BATCH_HDRLEN - hlen;
+}
@@ -51,6 +51,9 @@ alcove_call(alcove_state_t *ap, u_int32_t call,
 
     written = (*fun->fp)(ap, arg+index, len-index, reply, rlen);
 
+    /* release memory allocated while decoding the arguments */
+    alcove_arena_reset();
+
     if (written < 0)
         goto BADARG;
 
@@ -59,3 +62,37 @@ alcove_call(alcove_state_t *ap, u_int32_t call,
 BADARG:
     return alcove_mk_atom(reply, rlen, "badarg");
 }
+
+    const char *
+alcove_call_name(u_int32_t call)
+{
+    if (call >= sizeof(calls)/sizeof(calls[0]))
+        return NULL;
+
+    return calls[call].name;
+}
+
+/* Returns 1 if the reply is {error, _} or badarg */
+    int
+alcove_call_error(u_int16_t type, const char *reply, size_t rlen)
+{
+    int index = 0;
+    int version = 0;
+    int arity = 0;
+    char atom[MAXATOMLEN] = {0};
+
+    if (type == ALCOVE_MSG_RAWCALL)
+        return rlen > 0 && (reply[0] == ALCOVE_RAW_ERROR
+                || reply[0] == ALCOVE_RAW_ATOM);
+
+    if (ei_decode_version(reply, &index, &version) < 0)
+        return 0;
+
+    if (alcove_decode_atom(reply, rlen, &index, atom) == 0)
+        return strcmp(atom, "badarg") == 0;
+
+    return alcove_decode_tuple_header(reply, rlen, &index, &arity) == 0
+        && arity == 2
+        && alcove_decode_atom(reply, rlen, &index, atom) == 0
+        && strcmp(atom, "error") == 0;
+}
@@ -13,45 +13,70 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 #include "alcove.h"
+#include "alcove_call.h"
 
 #include <poll.h>
 #include <sys/wait.h>
 
-#include <sys/stat.h>
-
-enum {
-    ALCOVE_MSG_STDIN = 0,
-    ALCOVE_MSG_STDOUT,
-    ALCOVE_MSG_STDERR,
-    ALCOVE_MSG_PROXY,
-    ALCOVE_MSG_CALL,
-    ALCOVE_MSG_EVENT,
-    ALCOVE_MSG_CTL,
-    ALCOVE_MSG_PIPE,
-};
+#include <zlib.h>
 
-#define ALCOVE_CHILD_EXEC -2
+#include <sys/stat.h>
 
 #define ALCOVE_MSG_TYPE(s) \
     ((s->fdctl == ALCOVE_CHILD_EXEC) ? ALCOVE_MSG_STDOUT : ALCOVE_MSG_PROXY)
 
+#define ALCOVE_STDOUT_BUFFERED(ap) \
+    ((ap)->stdout_flush_bytes > 0 || (ap)->stdout_flush_ms > 0 \
+     || ((ap)->opt & alcove_opt_stdout_lines))
+
+/* child exits reported in one exited event */
+#define ALCOVE_EXITBATCH 128
+
+/* signals read from the signal pipe per iteration */
+#define ALCOVE_SIGBATCH 64
+
 #define ALCOVE_IOVEC_COUNT(_array) (sizeof(_array)/sizeof(_array[0]))
 
+/* status of a child reaped by the event loop */
+typedef struct {
+    pid_t pid;
+    int status;
+    struct rusage ru;
+} alcove_exit_t;
+
+/* data for the stdin of a child */
+typedef struct {
+    char *buf;
+    size_t len;
+    int sync;
+} alcove_stdin_t;
+
+/* counters of the process running the event loop */
+static alcove_stats_t *alcove_stats = NULL;
+
 static int alcove_stdin(alcove_state_t *ap);
 static ssize_t alcove_msg_call(alcove_state_t *ap, unsigned char *buf,
         u_int16_t buflen);
+static ssize_t alcove_msg_rawcall(alcove_state_t *ap, unsigned char *buf,
+        u_int16_t buflen);
+static int alcove_offload_drain(alcove_state_t *ap);
 
 static size_t alcove_proxy_hdr(unsigned char *hdr, size_t hdrlen,
         u_int16_t type, pid_t pid, size_t buflen);
 static size_t alcove_call_hdr(unsigned char *hdr, size_t hdrlen,
         u_int16_t type, size_t buflen);
 
-static ssize_t alcove_child_stdio(int fdin, u_int16_t depth,
-        alcove_child_t *c, u_int16_t type);
-static ssize_t alcove_call_reply(u_int16_t, char *, size_t);
+static ssize_t alcove_child_stdio(alcove_state_t *ap, int fdin,
+        alcove_child_t *c, u_int16_t type, size_t max);
+static ssize_t alcove_child_send(alcove_state_t *ap, alcove_child_t *c,
+        u_int16_t type, unsigned char *buf, size_t n);
+static ssize_t alcove_child_stdout_buffered(alcove_state_t *ap,
+        alcove_child_t *c, size_t max);
 static ssize_t alcove_call_spoof(pid_t pid, u_int16_t type,
         char *, size_t);
 
+static int alcove_child_wait(alcove_state_t *ap, alcove_child_t *c,
+        u_int64_t deadline);
 static int alcove_get_uint16(int fd, u_int16_t *val);
 static ssize_t alcove_read(int, void *, ssize_t);
 static ssize_t alcove_write(int fd, struct iovec *iov, int count);
@@ -62,14 +87,47 @@ static int set_pid(alcove_state_t *ap, alcove_child_t *c,
         void *arg1, void *arg2);
 static int write_to_pid(alcove_state_t *ap, alcove_child_t *c,
         void *arg1, void *arg2);
+static int stdinq_append(alcove_child_t *c, const char *buf, size_t len);
+static int stdinq_sync(alcove_child_t *c);
+static size_t stdinq_used(alcove_child_t *c);
+static int stdinq_drain(alcove_state_t *ap, alcove_child_t *c);
+static int stdinq_free(alcove_child_t *c, const char *reason);
+static int stdin_reply(alcove_child_t *c, const char *tag, const char *atom);
+static int read_from_children(alcove_state_t *ap, struct pollfd *fds);
 static int read_from_pid(alcove_state_t *ap, alcove_child_t *c,
         void *arg1, void *arg2);
+static int read_child_budget(alcove_state_t *ap, alcove_child_t *c,
+        int *fd, u_int64_t *count,
+        int (*read_child)(alcove_state_t *, alcove_child_t *, size_t));
+static int alcove_readable(int fd);
 static int read_child_fdctl(alcove_state_t *ap, alcove_child_t *c);
-static int read_child_stdout(alcove_state_t *ap, alcove_child_t *c);
-static int read_child_stderr(alcove_state_t *ap, alcove_child_t *c);
+static int read_child_stdout(alcove_state_t *ap, alcove_child_t *c,
+        size_t max);
+static int read_child_stderr(alcove_state_t *ap, alcove_child_t *c,
+        size_t max);
+
+static void alcove_bridge_poll(alcove_child_t *c, struct pollfd *fds);
+static int alcove_bridge_event(alcove_state_t *ap, alcove_child_t *c,
+        struct pollfd *fds);
+static ssize_t alcove_bridge_stdout(alcove_child_t *c);
+static int alcove_bridge_flush(alcove_state_t *ap, alcove_child_t *c);
+static ssize_t alcove_bridge_send(int fd, const void *buf, size_t len);
+static int alcove_bridge_close(alcove_state_t *ap, alcove_child_t *c,
+        int errnum);
+
+static int alcove_watch_event(alcove_state_t *ap, struct pollfd *fds);
+static int alcove_watch_ready(int fd, short revents);
 
 static int alcove_handle_signal(alcove_state_t *ap);
 static int alcove_signal_event(alcove_state_t *ap, siginfo_t *info);
+static int alcove_signal_flush(alcove_state_t *ap);
+static int alcove_reap(alcove_state_t *ap);
+static int alcove_exit_batch(alcove_state_t *ap, alcove_exit_t *exited,
+        int n);
+static int alcove_exit_reason(char *buf, size_t len, int *index,
+        int status);
+static int alcove_encode_rusage(char *buf, size_t len, int *index,
+        struct rusage *ru);
 
     void
 alcove_event_init(alcove_state_t *ap)
@@ -92,6 +150,12 @@ alcove_event_loop(alcove_state_t *ap)
     struct pollfd *fds = NULL;
 
     (void)memset(ap->child, 0, sizeof(alcove_child_t) * ap->fdsetsize);
+    (void)memset(ap->watch, 0, sizeof(u_int8_t) * ap->maxfd);
+    (void)memset(ap->timer, 0, sizeof(ap->timer));
+    (void)memset(&ap->stats, 0, sizeof(ap->stats));
+    (void)memset(ap->ncall, 0, sizeof(u_int64_t) * ALCOVE_NCALL);
+
+    alcove_stats = &ap->stats;
 
     fds = calloc(sizeof(struct pollfd), ap->maxfd);
     if (fds == NULL)
@@ -99,12 +163,21 @@ alcove_event_loop(alcove_state_t *ap)
 
     for ( ; ; ) {
         struct rlimit maxfd = {0};
+        int offload = -1;
         int i = 0;
+        int nfds = 0;
+
+        ap->stats.iterations++;
 
         if (getrlimit(RLIMIT_NOFILE, &maxfd) < 0)
             exit(errno);
 
         if (ap->maxfd != maxfd.rlim_cur) {
+            ap->watch = recallocarray(ap->watch, ap->maxfd,
+                    maxfd.rlim_cur, sizeof(u_int8_t));
+            if (ap->watch == NULL)
+                exit(errno);
+
             ap->maxfd = maxfd.rlim_cur;
             fds = reallocarray(fds, sizeof(struct pollfd), ap->maxfd);
             if (fds == NULL)
@@ -122,17 +195,38 @@ alcove_event_loop(alcove_state_t *ap)
         for (i = 0; i < ap->maxfd; i++) {
             fds[i].fd = -1;
             fds[i].revents = 0;
+
+            if (ap->watch_rearm)
+                ap->watch[i] &= ~ALCOVE_WATCH_DISARMED;
+
+            if (ap->watch[i] != 0
+                    && !(ap->watch[i] & ALCOVE_WATCH_DISARMED)) {
+                fds[i].fd = i;
+                fds[i].events =
+                    (ap->watch[i] & ALCOVE_WATCH_READ ? POLLIN : 0) |
+                    (ap->watch[i] & ALCOVE_WATCH_WRITE ? POLLOUT : 0);
+            }
         }
 
+        ap->watch_rearm = 0;
+
         fds[STDIN_FILENO].fd = STDIN_FILENO;
         fds[STDIN_FILENO].events = POLLIN;
 
+        offload = alcove_offload_fd();
+        if (offload > -1) {
+            fds[offload].fd = offload;
+            fds[offload].events = POLLIN;
+        }
+
         fds[ALCOVE_SIGREAD_FILENO].fd = ALCOVE_SIGREAD_FILENO;
         fds[ALCOVE_SIGREAD_FILENO].events = POLLIN;
 
         (void)pid_foreach(ap, 0, fds, NULL, pid_not_equal, set_pid);
 
-        if (poll(fds, ap->maxfd, -1) < 0) {
+        nfds = poll(fds, ap->maxfd, alcove_timer_timeout(ap));
+
+        if (nfds < 0) {
             switch (errno) {
                 case EINTR:
                     continue;
@@ -141,6 +235,9 @@ alcove_event_loop(alcove_state_t *ap)
             }
         }
 
+        if (nfds > 0)
+            ap->stats.wakeups++;
+
         if (fds[STDIN_FILENO].revents & (POLLIN|POLLERR|POLLHUP|POLLNVAL)) {
             switch (alcove_stdin(ap)) {
                 case 0:
@@ -160,7 +257,29 @@ alcove_event_loop(alcove_state_t *ap)
                 exit(errno);
         }
 
-        (void)pid_foreach(ap, 0, fds, NULL, pid_not_equal, read_from_pid);
+        if (offload > -1 && (fds[offload].revents & (POLLIN|POLLERR|POLLHUP|POLLNVAL))) {
+            if (alcove_offload_reply() < 0)
+                exit(errno);
+
+            /* children exited while the worker was in waitpid() */
+            if (ap->reap && !alcove_offload_waitpid()) {
+                ap->reap = 0;
+                if (alcove_reap(ap) < 0)
+                    exit(errno);
+            }
+
+            if (alcove_offload_drain(ap) < 0)
+                exit(errno);
+        }
+
+        if (read_from_children(ap, fds) < 0)
+            exit(errno);
+
+        if (alcove_watch_event(ap, fds) < 0)
+            exit(errno);
+
+        if (alcove_timer_expire(ap) < 0)
+            exit(errno);
     }
 }
 
@@ -172,6 +291,7 @@ alcove_stdin(alcove_state_t *ap)
     unsigned char msg[MAXMSGLEN] = {0};
     unsigned char *buf = msg;
     u_int16_t buflen = 0;
+    alcove_stdin_t data = {0};
 
     errno = 0;
 
@@ -179,6 +299,9 @@ alcove_stdin(alcove_state_t *ap)
      * Call:
      *  |length:2|call:2|command:2|arg:...|
      *
+     * Raw call:
+     *  |length:2|rawcall:2|command:2|arg:...|
+     *
      * Stdin:
      *  |length:2|stdin:2|pid:4|data:...|
      *
@@ -195,10 +318,26 @@ alcove_stdin(alcove_state_t *ap)
     if (alcove_read(STDIN_FILENO, buf, buflen) != buflen)
         return -1;
 
+    ap->stats.frames_in++;
+    ap->stats.bytes_in += buflen + sizeof(buflen);
+
     type = get_int16(buf);
     buf += 2;
     buflen -= 2;
 
+    switch (type) {
+        case ALCOVE_MSG_CALL:
+        case ALCOVE_MSG_RAWCALL:
+            /* run in order after the offloaded call has returned */
+            if (alcove_offload_queued())
+                return alcove_offload_enqueue(type, buf, buflen);
+
+            break;
+
+        default:
+            break;
+    }
+
     switch (type) {
         case ALCOVE_MSG_CALL:
             if (alcove_msg_call(ap, buf, buflen) < 0)
@@ -206,7 +345,14 @@ alcove_stdin(alcove_state_t *ap)
 
             return 0;
 
+        case ALCOVE_MSG_RAWCALL:
+            if (alcove_msg_rawcall(ap, buf, buflen) < 0)
+                return -1;
+
+            return 0;
+
         case ALCOVE_MSG_STDIN:
+        case ALCOVE_MSG_STDIN_SYNC:
             if (buflen < sizeof(pid))
                 return -1;
 
@@ -214,7 +360,11 @@ alcove_stdin(alcove_state_t *ap)
             buf += 4;
             buflen -= 4;
 
-            if ( (pid <= 0) || (pid_foreach(ap, pid, buf, &buflen, pid_equal,
+            data.buf = (char *)buf;
+            data.len = buflen;
+            data.sync = (type == ALCOVE_MSG_STDIN_SYNC);
+
+            if ( (pid <= 0) || (pid_foreach(ap, pid, &data, NULL, pid_equal,
                             write_to_pid) == 1)) {
                 int tlen = 0;
                 char t[MAXMSGLEN] = {0};
@@ -230,11 +380,34 @@ alcove_stdin(alcove_state_t *ap)
     }
 }
 
+/* Run the calls queued while an offloaded call was running */
+    static int
+alcove_offload_drain(alcove_state_t *ap)
+{
+    alcove_offload_msg_t *msg = NULL;
+    ssize_t rv = 0;
+
+    while (!alcove_offload_busy()
+            && (msg = alcove_offload_dequeue()) != NULL) {
+        rv = (msg->type == ALCOVE_MSG_RAWCALL)
+            ? alcove_msg_rawcall(ap, msg->buf, msg->len)
+            : alcove_msg_call(ap, msg->buf, msg->len);
+
+        free(msg);
+
+        if (rv < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
     static ssize_t
 alcove_msg_call(alcove_state_t *ap, unsigned char *buf, u_int16_t buflen)
 {
     u_int16_t call = 0;
-    char reply[MAXMSGLEN] = {0};
+    /* not zeroed: only the encoded reply is written */
+    char reply[MAXMSGLEN];
     ssize_t rlen = 0;
 
     if (buflen <= sizeof(call))
@@ -243,6 +416,18 @@ alcove_msg_call(alcove_state_t *ap, unsigned char *buf, u_int16_t buflen)
     call = get_int16(buf);
     buf += 2;
 
+    ap->watch_rearm = 1;
+
+    /* counters are updated by the event loop: calls run in the
+     * offload thread are counted when the reply is sent */
+    if (call < ALCOVE_NCALL)
+        ap->ncall[call]++;
+
+    /* the reply is sent by the event loop when the call returns */
+    if (alcove_offload_call(ap, ALCOVE_MSG_CALL, call, (const char *)buf,
+                buflen - 2))
+        return 0;
+
     rlen = alcove_call(ap, call, (const char *)buf, buflen,
             reply, ALCOVE_MSGLEN(ap->depth, sizeof(reply)));
 
@@ -252,9 +437,48 @@ alcove_msg_call(alcove_state_t *ap, unsigned char *buf, u_int16_t buflen)
     if (rlen < 0)
         return -1;
 
+    if (alcove_call_error(ALCOVE_MSG_CALL, reply, rlen))
+        ap->stats.errors++;
+
     return alcove_call_reply(ALCOVE_MSG_CALL, reply, rlen);
 }
 
+    static ssize_t
+alcove_msg_rawcall(alcove_state_t *ap, unsigned char *buf, u_int16_t buflen)
+{
+    u_int16_t call = 0;
+    /* not zeroed: only the encoded reply is written */
+    char reply[MAXMSGLEN];
+    ssize_t rlen = 0;
+
+    if (buflen < sizeof(call))
+        return -1;
+
+    call = get_int16(buf);
+    buf += 2;
+    buflen -= 2;
+
+    ap->watch_rearm = 1;
+
+    if (call < ALCOVE_NCALL)
+        ap->ncall[call]++;
+
+    if (alcove_offload_call(ap, ALCOVE_MSG_RAWCALL, call, (const char *)buf,
+                buflen))
+        return 0;
+
+    rlen = alcove_rawcall(ap, call, (const char *)buf, buflen,
+            reply, ALCOVE_MSGLEN(ap->depth, sizeof(reply)));
+
+    if (rlen < 0)
+        return -1;
+
+    if (alcove_call_error(ALCOVE_MSG_RAWCALL, reply, rlen))
+        ap->stats.errors++;
+
+    return alcove_call_reply(ALCOVE_MSG_RAWCALL, reply, rlen);
+}
+
     static size_t
 alcove_proxy_hdr(unsigned char *hdr, size_t hdrlen, u_int16_t type,
         pid_t pid, size_t buflen)
@@ -287,24 +511,24 @@ alcove_call_hdr(unsigned char *hdr, size_t hdrlen, u_int16_t type,
 }
 
     static ssize_t
-alcove_child_stdio(int fdin, u_int16_t depth, alcove_child_t *c,
-        u_int16_t type)
+alcove_child_stdio(alcove_state_t *ap, int fdin, alcove_child_t *c,
+        u_int16_t type, size_t max)
 {
-    struct iovec iov[2];
-
     ssize_t n = 0;
     unsigned char buf[MAXMSGLEN] = {0};
-    unsigned char hdr[MAXHDRLEN] = {0};
-    u_int16_t hdrlen = 0;
-    size_t read_len = sizeof(hdrlen);
+    size_t read_len = sizeof(u_int16_t);
 
-    /* If the child has called exec(), treat the data as a stream.
+    /* If the child has called exec(), treat the data as a stream: at
+     * most max bytes are read if max is not 0.
      *
      * Otherwise, read in the length header and do an exact read.
      */
     if ( (c->fdctl == ALCOVE_CHILD_EXEC)
-            || (type == ALCOVE_MSG_STDERR))
-        read_len = ALCOVE_MSGLEN(depth, sizeof(buf));
+            || (type == ALCOVE_MSG_STDERR)) {
+        read_len = ALCOVE_MSGLEN(ap->depth, sizeof(buf));
+        if (max > 0)
+            read_len = MIN(read_len, max);
+    }
 
     n = read(fdin, buf, read_len);
 
@@ -331,6 +555,52 @@ alcove_child_stdio(int fdin, u_int16_t depth, alcove_child_t *c,
             return -1;
 
         n += 2;
+
+        /* the reply to a call which has timed out: see alcove_child_call() */
+        if (get_int16(buf+2) == ALCOVE_MSG_CALL && c->discard > 0) {
+            c->discard--;
+            return n;
+        }
+    }
+
+    c->nread++;
+    if (type == ALCOVE_MSG_STDERR)
+        c->nerr += n;
+    else
+        c->nout += n;
+
+    return alcove_child_send(ap, c, type, buf, n);
+}
+
+/*
+ * Send the output of a child. If compression is enabled, each read from
+ * the stdout and stderr of an exec'ed child is compressed separately
+ * using compress2() and sent as a self-contained zlib frame:
+ *
+ *  ALCOVE_MSG_STDOUT -> ALCOVE_MSG_STDOUT_DEFLATE
+ *  ALCOVE_MSG_STDERR -> ALCOVE_MSG_STDERR_DEFLATE
+ *
+ * Data shorter than ALCOVE_COMPRESS_MIN or data that does not shrink
+ * is sent uncompressed.
+ */
+    static ssize_t
+alcove_child_send(alcove_state_t *ap, alcove_child_t *c, u_int16_t type,
+        unsigned char *buf, size_t n)
+{
+    struct iovec iov[2];
+    unsigned char hdr[MAXHDRLEN] = {0};
+    unsigned char z[MAXMSGLEN];
+    uLongf zlen = n - 1;
+    u_int16_t hdrlen = 0;
+
+    if (ap->compress > 0 && n >= ALCOVE_COMPRESS_MIN
+            && (type == ALCOVE_MSG_STDOUT || type == ALCOVE_MSG_STDERR)
+            && compress2(z, &zlen, buf, n, ap->compress) == Z_OK) {
+        type = (type == ALCOVE_MSG_STDOUT)
+            ? ALCOVE_MSG_STDOUT_DEFLATE
+            : ALCOVE_MSG_STDERR_DEFLATE;
+        buf = z;
+        n = zlen;
     }
 
     hdrlen = alcove_proxy_hdr(hdr, sizeof(hdr), type, c->pid, n);
@@ -346,7 +616,275 @@ alcove_child_stdio(int fdin, u_int16_t depth, alcove_child_t *c,
     return alcove_write(STDOUT_FILENO, iov, ALCOVE_IOVEC_COUNT(iov));
 }
 
+/*
+ * Output aggregation: the stdout of an exec'ed child is buffered and
+ * sent when:
+ *
+ *  - stdout_flush_bytes have been buffered
+ *  - the oldest buffered data is older than stdout_flush_ms
+ *  - the buffer is full or stdout is closed
+ *
+ * With stdout_lines, only whole lines are sent: a partial line is held
+ * until it is terminated, the buffer is full or stdout is closed. If
+ * no threshold is set, lines are sent as they are completed.
+ */
     static ssize_t
+alcove_child_stdout_buffered(alcove_state_t *ap, alcove_child_t *c,
+        size_t limit)
+{
+    alcove_outbuf_t *ob = c->outbuf;
+    size_t max = ALCOVE_MSGLEN(ap->depth, sizeof(ob->buf));
+    size_t len = 0;
+    ssize_t n = 0;
+    int err = 0;
+
+    if (ob == NULL) {
+        ob = calloc(1, sizeof(alcove_outbuf_t));
+        if (ob == NULL)
+            return -1;
+        c->outbuf = ob;
+    }
+
+    len = max - ob->len;
+    if (limit > 0)
+        len = MIN(len, limit);
+
+    n = read(c->fdout, ob->buf + ob->len, len);
+
+    if (n <= 0) {
+        err = errno;
+        if (alcove_child_flush(ap, c, 1) < 0)
+            return -1;
+        return (n == 0 || err == EINTR || err == EAGAIN) ? 0 : -1;
+    }
+
+    if (ob->len == 0)
+        ob->since = alcove_timer_now();
+
+    ob->len += n;
+
+    c->nread++;
+    c->nout += n;
+
+    ap->stats.stdout_buffer_hwm = MAX(ap->stats.stdout_buffer_hwm,
+            ob->len);
+
+    if (ob->len >= max
+            || (ap->stdout_flush_bytes > 0
+                && ob->len >= ap->stdout_flush_bytes)
+            || (ap->stdout_flush_bytes == 0 && ap->stdout_flush_ms == 0)) {
+        if (alcove_child_flush(ap, c, 0) < 0)
+            return -1;
+    }
+
+    return n;
+}
+
+/*
+ * Send the buffered stdout of a child. Unless all is set, a partial
+ * line is held in line mode if there is space in the buffer.
+ */
+    int
+alcove_child_flush(alcove_state_t *ap, alcove_child_t *c, int all)
+{
+    alcove_outbuf_t *ob = c->outbuf;
+    size_t n = 0;
+
+    if (ob == NULL || ob->len == 0)
+        return 0;
+
+    /* in line mode, the partial line is sent in a separate frame */
+    if (all && (ap->opt & alcove_opt_stdout_lines)) {
+        if (alcove_child_flush(ap, c, 0) < 0)
+            return -1;
+        if (ob->len == 0)
+            return 0;
+    }
+
+    n = ob->len;
+
+    if (!all && (ap->opt & alcove_opt_stdout_lines)) {
+        while (n > 0 && ob->buf[n-1] != '\n')
+            n--;
+
+        if (n == 0) {
+            if (ob->len < ALCOVE_MSGLEN(ap->depth, sizeof(ob->buf))) {
+                /* restart the deadline for the partial line */
+                ob->since = alcove_timer_now();
+                return 0;
+            }
+            n = ob->len;
+        }
+    }
+
+    if (alcove_child_send(ap, c, ALCOVE_MSG_STDOUT,
+                (unsigned char *)ob->buf, n) < 0)
+        return -1;
+
+    ob->len -= n;
+
+    if (ob->len > 0) {
+        (void)memmove(ob->buf, ob->buf + n, ob->len);
+        ob->since = alcove_timer_now();
+    }
+
+    return 0;
+}
+
+/*
+ * Write data to the stdin of a child. Data that can't be written is
+ * queued and written by the event loop.
+ *
+ * Returns 0 on success or -1 if stdin is closed or on error.
+ */
+    int
+alcove_child_stdin(alcove_state_t *ap, alcove_child_t *c, char *buf,
+        size_t len)
+{
+    alcove_stdin_t data = {0};
+
+    data.buf = buf;
+    data.len = len;
+
+    return write_to_pid(ap, c, &data, NULL) == 0 ? 0 : -1;
+}
+
+/*
+ * Read the reply to a call from a forked child. Any other messages
+ * sent by the child are proxied to the port. Data queued for the stdin
+ * of the child is written while waiting.
+ *
+ * The reply must be received before the deadline (monotonic ms, 0 waits
+ * indefinitely): if the deadline passes, errno is set to ETIMEDOUT and
+ * the reply is discarded by the event loop when it arrives.
+ *
+ * Returns the length of the reply, 0 if the child closed stdout or -1
+ * on error.
+ */
+    ssize_t
+alcove_child_call(alcove_state_t *ap, alcove_child_t *c, char *buf,
+        size_t len, u_int64_t deadline)
+{
+    struct iovec iov[2];
+
+    unsigned char msg[MAXMSGLEN] = {0};
+    unsigned char hdr[MAXHDRLEN] = {0};
+    u_int16_t hdrlen = 0;
+    u_int16_t msglen = 0;
+    ssize_t n = 0;
+
+    errno = 0;
+
+    if (c->fdout < 0 || c->fdctl == ALCOVE_CHILD_EXEC)
+        return -1;
+
+    for ( ; ; ) {
+        switch (alcove_child_wait(ap, c, deadline)) {
+            case 0:
+                c->discard++;
+                errno = ETIMEDOUT;
+                return -1;
+            case 1:
+                break;
+            default:
+                return -1;
+        }
+
+        n = alcove_get_uint16(c->fdout, &msglen);
+
+        if (n != sizeof(msglen))
+            return (n == 0) ? 0 : -1;
+
+        if (msglen < 2 || msglen > sizeof(msg) - 2)
+            return -1;
+
+        if (alcove_read(c->fdout, msg+2, msglen) != msglen)
+            return -1;
+
+        /* the reply to a call which has timed out */
+        if (get_int16(msg+2) == ALCOVE_MSG_CALL && c->discard > 0) {
+            c->discard--;
+            continue;
+        }
+
+        if (get_int16(msg+2) == ALCOVE_MSG_CALL) {
+            if (msglen - 2 > len)
+                return -1;
+
+            (void)memcpy(buf, msg+4, msglen - 2);
+            return msglen - 2;
+        }
+
+        put_int16(msglen, msg);
+
+        hdrlen = alcove_proxy_hdr(hdr, sizeof(hdr), ALCOVE_MSG_PROXY,
+                c->pid, msglen + 2);
+
+        if (hdrlen == 0)
+            return -1;
+
+        iov[0].iov_base = hdr;
+        iov[0].iov_len = hdrlen;
+        iov[1].iov_base = msg;
+        iov[1].iov_len = msglen + 2;
+
+        if (alcove_write(STDOUT_FILENO, iov, ALCOVE_IOVEC_COUNT(iov)) < 0)
+            return -1;
+    }
+}
+
+/*
+ * Wait for the stdout of a child to be readable, writing any data queued
+ * for stdin.
+ *
+ * Returns 1 if stdout is readable, 0 if the deadline has passed or -1
+ * on error.
+ */
+    static int
+alcove_child_wait(alcove_state_t *ap, alcove_child_t *c, u_int64_t deadline)
+{
+    struct pollfd fds[2];
+    int timeout = -1;
+    u_int64_t now = 0;
+
+    for ( ; ; ) {
+        (void)memset(fds, 0, sizeof(fds));
+
+        fds[0].fd = c->fdout;
+        fds[0].events = POLLIN;
+
+        fds[1].fd = (c->stdinq != NULL) ? c->fdin : -1;
+        fds[1].events = POLLOUT;
+
+        if (deadline > 0) {
+            now = alcove_timer_now();
+            if (now >= deadline)
+                return 0;
+            timeout = MIN(deadline - now, INT32_MAX);
+        }
+
+        switch (poll(fds, 2, timeout)) {
+            case -1:
+                if (errno == EINTR)
+                    continue;
+                return -1;
+            case 0:
+                return 0;
+            default:
+                break;
+        }
+
+        if (fds[1].revents & (POLLOUT|POLLERR|POLLHUP|POLLNVAL)) {
+            if (stdinq_drain(ap, c) < 0)
+                return -1;
+        }
+
+        if (fds[0].revents & (POLLIN|POLLERR|POLLHUP|POLLNVAL))
+            return 1;
+    }
+}
+
+    ssize_t
 alcove_call_reply(u_int16_t type, char *buf, size_t len)
 {
     struct iovec iov[2];
@@ -451,13 +989,19 @@ alcove_write(int fd, struct iovec *iov, int count)
 
     } while (offset < count);
 
+    if (fd == STDOUT_FILENO && alcove_stats != NULL) {
+        alcove_stats->frames_out++;
+        alcove_stats->bytes_out += n;
+    }
+
     return n;
 }
 
     static int
 exited_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
 {
-    int *status = arg1;
+    alcove_exit_t *e = arg1;
+    int *status = &e->status;
     int index = 0;
     char t[MAXMSGLEN] = {0};
 
@@ -465,8 +1009,11 @@ exited_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
 
     /* Flush any pending reads and ensure messages are received in order */
     if (c->fdctl > -1) (void)read_child_fdctl(ap, c);
-    if (c->fdout > -1) (void)read_child_stdout(ap, c);
-    if (c->fderr > -1) (void)read_child_stderr(ap, c);
+    if (c->fdout > -1) (void)read_child_stdout(ap, c, 0);
+    if (c->fderr > -1) (void)read_child_stderr(ap, c, 0);
+
+    if (alcove_child_flush(ap, c, 1) < 0)
+        return -1;
 
     if ( (c->fdin >= 0) && (ap->opt & alcove_opt_stdin_closed)) {
         index = alcove_mk_atom(t, sizeof(t), "stdin_closed");
@@ -478,12 +1025,29 @@ exited_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
     (void)close(c->fdin);
     c->fdin = -1;
 
+    if (stdinq_free(c, "epipe") < 0)
+        return -1;
+
+    if (c->bridge != NULL && alcove_bridge_flush(ap, c) < 0)
+        return -1;
+
+    /* reported by alcove_reap() */
+    if (ap->opt & alcove_opt_exit_batch)
+        return 0;
+
     if (WIFEXITED(*status)) {
         if (ap->opt & alcove_opt_exit_status) {
-            ALCOVE_TUPLE2(t, sizeof(t), &index,
-                    "exit_status",
-                    alcove_encode_long(t, sizeof(t), &index, WEXITSTATUS(*status))
-                    );
+            if (ap->opt & alcove_opt_exit_rusage)
+                ALCOVE_TUPLE3(t, sizeof(t), &index,
+                        "exit_status",
+                        alcove_encode_long(t, sizeof(t), &index, WEXITSTATUS(*status)),
+                        alcove_encode_rusage(t, sizeof(t), &index, &e->ru)
+                        );
+            else
+                ALCOVE_TUPLE2(t, sizeof(t), &index,
+                        "exit_status",
+                        alcove_encode_long(t, sizeof(t), &index, WEXITSTATUS(*status))
+                        );
 
             if (alcove_call_spoof(c->pid, ALCOVE_MSG_EVENT, t, index))
                 return -1;
@@ -492,10 +1056,17 @@ exited_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
 
     if (WIFSIGNALED(*status)) {
         if (ap->opt & alcove_opt_termsig) {
-            ALCOVE_TUPLE2(t, sizeof(t), &index,
-                "termsig",
-                alcove_signal_name(t, sizeof(t), &index, WTERMSIG(*status))
-            );
+            if (ap->opt & alcove_opt_exit_rusage)
+                ALCOVE_TUPLE3(t, sizeof(t), &index,
+                    "termsig",
+                    alcove_signal_name(t, sizeof(t), &index, WTERMSIG(*status)),
+                    alcove_encode_rusage(t, sizeof(t), &index, &e->ru)
+                );
+            else
+                ALCOVE_TUPLE2(t, sizeof(t), &index,
+                    "termsig",
+                    alcove_signal_name(t, sizeof(t), &index, WTERMSIG(*status))
+                );
 
             if (alcove_call_spoof(c->pid, ALCOVE_MSG_EVENT, t, index) < 0)
                 return -1;
@@ -528,7 +1099,22 @@ set_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
         fds[c->fderr].events = POLLIN;
     }
 
-    if (c->exited && c->fdout == -1 && c->fderr == -1 && c->fdctl < 0) {
+    if (c->stdinq != NULL && c->fdin > -1) {
+        fds[c->fdin].fd = c->fdin;
+        fds[c->fdin].events = POLLOUT;
+    }
+
+    if (c->bridge != NULL && c->fdctl == ALCOVE_CHILD_EXEC)
+        alcove_bridge_poll(c, fds);
+
+    /* a bridge is closed after the data has been relayed */
+    if (c->exited && c->fdout == -1 && c->fderr == -1 && c->fdctl < 0
+            && (c->bridge == NULL || c->fdctl != ALCOVE_CHILD_EXEC)) {
+        if (c->bridge != NULL) {
+            (void)close(c->bridge->fd);
+            free(c->bridge);
+            c->bridge = NULL;
+        }
         c->pid = 0;
         c->exited = 0;
     }
@@ -536,42 +1122,286 @@ set_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
     return 1;
 }
 
+/*
+ * Data that cannot be written to the stdin of a child is queued and
+ * written when the pipe is writable. For an exec'ed child, data
+ * exceeding the queue limit is refused:
+ *
+ *  {alcove_pipe, Written}
+ *
+ * A child that has not called exec reads framed messages from stdin:
+ * the remainder of a partially written frame is always queued.
+ *
+ * When the queue has drained, the child is sent a credit:
+ *
+ *  {stdin_credit, Bytes}
+ *
+ * Data sent using stdin_sync is always queued. The caller is sent a
+ * reply, in order, when each write has completed:
+ *
+ *  {stdin_sync, ok | epipe}
+ */
     static int
 write_to_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
 {
-    char *buf = arg1;
-    u_int16_t *buflen = arg2;
+    alcove_stdin_t *data = arg1;
     ssize_t n = 0;
-    ssize_t written = 0;
+    size_t written = 0;
 
-    UNUSED(ap);
+    UNUSED(arg2);
 
-    if (c->fdin == -1)
+    if (c->fdin == -1) {
+        if (data->sync && stdin_reply(c, "stdin_sync", "epipe") < 0)
+            return -1;
         return -2;
+    }
 
-    do {
-        n = write(c->fdin, buf + written, *buflen - written);
+    /* data is written in order */
+    while (c->stdinq == NULL && written < data->len) {
+        n = write(c->fdin, data->buf + written, data->len - written);
 
-        if (n <= 0) {
-            switch (errno) {
-                case EINTR:
-                    continue;
-                case EAGAIN: {
-                    int tlen = 0;
-                    char t[MAXMSGLEN] = {0};
-                    tlen = alcove_mk_long(t, sizeof(t), written);
-                    if (alcove_call_spoof(c->pid, ALCOVE_MSG_PIPE, t, tlen) < 0)
-                        abort();
-                    break;
-                }
-                default:
-                    break;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                ap->stats.eagain++;
+                break;
             }
-            return n;
+            if (data->sync && stdin_reply(c, "stdin_sync", "epipe") < 0)
+                return -1;
+            return -2;
         }
 
         written += n;
-    } while (written < *buflen);
+        c->nin += n;
+    }
+
+    if (c->stdinq == NULL && written == data->len) {
+        if (data->sync && stdin_reply(c, "stdin_sync", "ok") < 0)
+            return -1;
+        return 0;
+    }
+
+    if (!data->sync && c->fdctl == ALCOVE_CHILD_EXEC
+            && stdinq_used(c) + data->len - written > ap->stdin_queue) {
+        int tlen = 0;
+        char t[MAXMSGLEN] = {0};
+
+        /* the credit is sent when the queue is writable */
+        if (stdinq_append(c, NULL, 0) < 0)
+            return -1;
+        c->stdinq->credit = 1;
+
+        ap->stats.refused += data->len - written;
+
+        tlen = alcove_mk_long(t, sizeof(t), written);
+        if (alcove_call_spoof(c->pid, ALCOVE_MSG_PIPE, t, tlen) < 0)
+            return -1;
+
+        return 0;
+    }
+
+    if (stdinq_append(c, data->buf + written, data->len - written) < 0)
+        return -1;
+
+    ap->stats.stdin_queue_hwm = MAX(ap->stats.stdin_queue_hwm,
+            stdinq_used(c));
+
+    if (data->sync && stdinq_sync(c) < 0)
+        return -1;
+
+    return 0;
+}
+
+    static int
+stdinq_append(alcove_child_t *c, const char *buf, size_t len)
+{
+    alcove_stdinq_t *q = c->stdinq;
+
+    if (q == NULL) {
+        q = calloc(1, sizeof(alcove_stdinq_t));
+        if (q == NULL)
+            return -1;
+        c->stdinq = q;
+    }
+
+    if (len == 0)
+        return 0;
+
+    /* move the queued data to the start of the buffer */
+    if (q->off > 0) {
+        size_t i = 0;
+
+        (void)memmove(q->buf, q->buf + q->off, q->len - q->off);
+        q->len -= q->off;
+        for (i = 0; i < q->nsync; i++)
+            q->sync[i] -= q->off;
+        q->off = 0;
+    }
+
+    if (q->len + len > q->size) {
+        size_t size = MAX(q->size * 2, q->len + len);
+        char *buf = realloc(q->buf, size);
+
+        if (buf == NULL)
+            return -1;
+
+        q->buf = buf;
+        q->size = size;
+    }
+
+    (void)memcpy(q->buf + q->len, buf, len);
+    q->len += len;
+
+    return 0;
+}
+
+/* Mark the end of the queued data: replied to when written */
+    static int
+stdinq_sync(alcove_child_t *c)
+{
+    alcove_stdinq_t *q = c->stdinq;
+
+    if (q->nsync == q->maxsync) {
+        size_t maxsync = MAX(q->maxsync * 2, 4);
+        size_t *sync = realloc(q->sync, maxsync * sizeof(size_t));
+
+        if (sync == NULL)
+            return -1;
+
+        q->sync = sync;
+        q->maxsync = maxsync;
+    }
+
+    q->sync[q->nsync++] = q->len;
+
+    return 0;
+}
+
+    static size_t
+stdinq_used(alcove_child_t *c)
+{
+    return (c->stdinq == NULL) ? 0 : c->stdinq->len - c->stdinq->off;
+}
+
+/* Write queued data when the pipe is writable */
+    static int
+stdinq_drain(alcove_state_t *ap, alcove_child_t *c)
+{
+    alcove_stdinq_t *q = c->stdinq;
+    ssize_t n = 0;
+    size_t i = 0;
+
+    while (q->off < q->len) {
+        n = write(c->fdin, q->buf + q->off, q->len - q->off);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return stdinq_free(c, "epipe");
+        }
+
+        q->off += n;
+        c->nin += n;
+    }
+
+    for (i = 0; i < q->nsync && q->off >= q->sync[i]; i++) {
+        if (stdin_reply(c, "stdin_sync", "ok") < 0)
+            return -1;
+    }
+
+    if (i > 0) {
+        q->nsync -= i;
+        (void)memmove(q->sync, q->sync + i, q->nsync * sizeof(size_t));
+    }
+
+    if (q->off < q->len)
+        return 0;
+
+    if (q->credit) {
+        int index = 0;
+        char t[MAXMSGLEN] = {0};
+
+        ALCOVE_TUPLE2(t, sizeof(t), &index,
+            "stdin_credit",
+            alcove_encode_ulonglong(t, sizeof(t), &index, ap->stdin_queue)
+        );
+
+        if (alcove_call_spoof(c->pid, ALCOVE_MSG_PIPE, t, index) < 0)
+            return -1;
+    }
+
+    return stdinq_free(c, NULL);
+}
+
+/* Discard the queue: each pending stdin_sync is sent the reason */
+    static int
+stdinq_free(alcove_child_t *c, const char *reason)
+{
+    alcove_stdinq_t *q = c->stdinq;
+    size_t i = 0;
+    int rv = 0;
+
+    if (q == NULL)
+        return 0;
+
+    for (i = 0; i < q->nsync && reason != NULL && rv == 0; i++)
+        rv = stdin_reply(c, "stdin_sync", reason);
+
+    free(q->sync);
+    free(q->buf);
+    free(q);
+    c->stdinq = NULL;
+
+    return rv;
+}
+
+    static int
+stdin_reply(alcove_child_t *c, const char *tag, const char *atom)
+{
+    int index = 0;
+    char t[MAXMSGLEN] = {0};
+
+    ALCOVE_TUPLE2(t, sizeof(t), &index,
+        tag,
+        alcove_encode_atom(t, sizeof(t), &index, atom)
+    );
+
+    return alcove_call_spoof(c->pid, ALCOVE_MSG_PIPE, t, index) < 0 ? -1 : 0;
+}
+
+/*
+ * Children are serviced in two passes. The first pass reads control
+ * messages and the replies of children that have not called exec. The
+ * second pass reads the output of exec'ed children and stderr, up to
+ * the read budget for each child.
+ *
+ * Each iteration starts at the next child in the table.
+ */
+    static int
+read_from_children(alcove_state_t *ap, struct pollfd *fds)
+{
+    int pass = 0;
+    int n = 0;
+
+    if (ap->fdsetsize == 0)
+        return 0;
+
+    for (pass = 0; pass < 2; pass++) {
+        for (n = 0; n < ap->fdsetsize; n++) {
+            alcove_child_t *c = &ap->child[(ap->rrindex + n) % ap->fdsetsize];
+
+            if (c->pid == 0)
+                continue;
+
+            if (read_from_pid(ap, c, fds, &pass) < 0)
+                return -1;
+        }
+    }
+
+    ap->rrindex = (ap->rrindex + 1) % ap->fdsetsize;
 
     return 0;
 }
@@ -580,30 +1410,112 @@ write_to_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
 read_from_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
 {
     struct pollfd *fds = arg1;
+    int *pass = arg2;
 
-    UNUSED(arg2);
+    if (*pass == 0) {
+        if (c->stdinq != NULL && c->fdin > -1 &&
+                (fds[c->fdin].revents & (POLLOUT|POLLERR|POLLHUP|POLLNVAL))) {
+            if (stdinq_drain(ap, c) < 0)
+                return -1;
+        }
 
-    if (c->fdctl > -1 &&
-            (fds[c->fdctl].revents & (POLLIN|POLLERR|POLLHUP|POLLNVAL))) {
-        if (read_child_fdctl(ap, c) < 0)
-            return -1;
+        if (c->fdctl > -1 &&
+                (fds[c->fdctl].revents & (POLLIN|POLLERR|POLLHUP|POLLNVAL))) {
+            if (read_child_fdctl(ap, c) < 0)
+                return -1;
+        }
+
+        /* replies: the child may call exec after the control message */
+        if (c->fdout > -1 && c->fdctl != ALCOVE_CHILD_EXEC &&
+                (fds[c->fdout].revents & (POLLIN|POLLERR|POLLHUP|POLLNVAL))) {
+            fds[c->fdout].revents = 0;
+            if (read_child_stdout(ap, c, 0) < 0)
+                return -1;
+        }
+
+        return 1;
     }
 
     if (c->fdout > -1 &&
             (fds[c->fdout].revents & (POLLIN|POLLERR|POLLHUP|POLLNVAL))) {
-        if (read_child_stdout(ap, c) < 0)
+        /* the bridge reads when the buffered data has been sent */
+        if (c->bridge != NULL && c->fdctl == ALCOVE_CHILD_EXEC) {
+            if (read_child_stdout(ap, c, 0) < 0)
+                return -1;
+        }
+        else if (read_child_budget(ap, c, &c->fdout, &c->nout,
+                    read_child_stdout) < 0)
             return -1;
     }
 
     if (c->fderr > -1 &&
             (fds[c->fderr].revents & (POLLIN|POLLERR|POLLHUP|POLLNVAL))) {
-        if (read_child_stderr(ap, c) < 0)
+        if (read_child_budget(ap, c, &c->fderr, &c->nerr,
+                    read_child_stderr) < 0)
+            return -1;
+    }
+
+    if (c->bridge != NULL && c->fdctl == ALCOVE_CHILD_EXEC) {
+        if (alcove_bridge_event(ap, c, fds) < 0)
             return -1;
     }
 
     return 1;
 }
 
+/*
+ * Read from a descriptor until the budget is used or no data is
+ * available: each read is limited to the remaining budget. A budget of
+ * 0 reads once.
+ */
+    static int
+read_child_budget(alcove_state_t *ap, alcove_child_t *c,
+        int *fd, u_int64_t *count,
+        int (*read_child)(alcove_state_t *, alcove_child_t *, size_t))
+{
+    u_int64_t start = *count;
+    u_int64_t used = 0;
+
+    if (ap->read_budget == 0)
+        return (*read_child)(ap, c, 0);
+
+    for ( ; ; ) {
+        if ((*read_child)(ap, c, ap->read_budget - used) < 0)
+            return -1;
+
+        if (*fd < 0)
+            return 0;
+
+        /* no data was read */
+        if (*count - start == used)
+            return 0;
+
+        used = *count - start;
+
+        if (!alcove_readable(*fd))
+            return 0;
+
+        if (used >= ap->read_budget)
+            break;
+    }
+
+    /* readable data was left for the next pass */
+    c->nthrottle++;
+
+    return 0;
+}
+
+    static int
+alcove_readable(int fd)
+{
+    struct pollfd pfd = {0};
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+}
+
     static int
 read_child_fdctl(alcove_state_t *ap, alcove_child_t *c)
 {
@@ -630,12 +1542,23 @@ read_child_fdctl(alcove_state_t *ap, alcove_child_t *c)
 }
 
     static int
-read_child_stdout(alcove_state_t *ap, alcove_child_t *c)
+read_child_stdout(alcove_state_t *ap, alcove_child_t *c, size_t max)
 {
     int len = 0;
     char t[MAXMSGLEN] = {0};
+    int bridged = (c->bridge != NULL && c->fdctl == ALCOVE_CHILD_EXEC);
+    int buffered = (!bridged && c->fdctl == ALCOVE_CHILD_EXEC
+            && ALCOVE_STDOUT_BUFFERED(ap));
+    ssize_t n = 0;
+
+    if (bridged)
+        n = alcove_bridge_stdout(c);
+    else if (buffered || c->outbuf != NULL)
+        n = alcove_child_stdout_buffered(ap, c, max);
+    else
+        n = alcove_child_stdio(ap, c->fdout, c, ALCOVE_MSG_TYPE(c), max);
 
-    switch (alcove_child_stdio(c->fdout, ap->depth, c, ALCOVE_MSG_TYPE(c))) {
+    switch (n) {
         case 0:
             if (ap->opt & alcove_opt_stdout_closed) {
                 len = alcove_mk_atom(t, sizeof(t), "stdout_closed");
@@ -646,21 +1569,25 @@ read_child_stdout(alcove_state_t *ap, alcove_child_t *c)
         case -1:
             (void)close(c->fdout);
             c->fdout = -1;
+            free(c->outbuf);
+            c->outbuf = NULL;
+            if (bridged)
+                c->bridge->flags |= ALCOVE_BRIDGE_OUT_EOF;
             break;
         default:
             break;
     }
 
-    return 0;
+    return bridged ? alcove_bridge_flush(ap, c) : 0;
 }
 
     static int
-read_child_stderr(alcove_state_t *ap, alcove_child_t *c)
+read_child_stderr(alcove_state_t *ap, alcove_child_t *c, size_t max)
 {
     int len = 0;
     char t[MAXMSGLEN] = {0};
 
-    switch (alcove_child_stdio(c->fderr, ap->depth, c, ALCOVE_MSG_STDERR)) {
+    switch (alcove_child_stdio(ap, c->fderr, c, ALCOVE_MSG_STDERR, max)) {
         case 0:
             if (ap->opt & alcove_opt_stderr_closed) {
                 len = alcove_mk_atom(t, sizeof(t), "stderr_closed");
@@ -679,48 +1606,474 @@ read_child_stderr(alcove_state_t *ap, alcove_child_t *c)
     return 0;
 }
 
+/*
+ * Bridge: relay data between a socket and the stdin and stdout of an
+ * exec'ed child. Data is read from one side when the data previously
+ * read has been written to the other side.
+ */
+    static void
+alcove_bridge_poll(alcove_child_t *c, struct pollfd *fds)
+{
+    alcove_bridge_t *b = c->bridge;
+    short events = 0;
+
+    if (c->fdout > -1 && b->outlen > 0)
+        fds[c->fdout].fd = -1;
+
+    if (c->fdin > -1 && b->inlen > 0) {
+        fds[c->fdin].fd = c->fdin;
+        fds[c->fdin].events = POLLOUT;
+    }
+
+    if (c->fdin > -1 && b->inlen == 0 && !(b->flags & ALCOVE_BRIDGE_IN_EOF))
+        events |= POLLIN;
+
+    if (b->outlen > 0)
+        events |= POLLOUT;
+
+    if (events != 0) {
+        fds[b->fd].fd = b->fd;
+        fds[b->fd].events = events;
+    }
+}
+
+    static int
+alcove_bridge_event(alcove_state_t *ap, alcove_child_t *c,
+        struct pollfd *fds)
+{
+    alcove_bridge_t *b = c->bridge;
+    ssize_t n = 0;
+
+    if (b == NULL)
+        return 0;
+
+    if ( (fds[b->fd].revents & (POLLIN|POLLERR|POLLHUP|POLLNVAL))
+            && (fds[b->fd].events & POLLIN)) {
+        n = read(b->fd, b->inbuf, sizeof(b->inbuf));
+
+        if (n == 0)
+            b->flags |= ALCOVE_BRIDGE_IN_EOF;
+        else if (n > 0) {
+            b->inlen = n;
+            b->inoff = 0;
+        }
+        else if (errno != EINTR && errno != EAGAIN)
+            return alcove_bridge_close(ap, c, errno);
+    }
+
+    return alcove_bridge_flush(ap, c);
+}
+
+/* Returns the number of bytes read, 0 on EOF or -1 on error */
+    static ssize_t
+alcove_bridge_stdout(alcove_child_t *c)
+{
+    alcove_bridge_t *b = c->bridge;
+    ssize_t n = 0;
+
+    n = read(c->fdout, b->outbuf, sizeof(b->outbuf));
+
+    if (n < 0)
+        return (errno == EINTR || errno == EAGAIN) ? 1 : -1;
+
+    b->outlen = n;
+    b->outoff = 0;
+
+    c->nread++;
+    c->nout += n;
+
+    return n;
+}
+
+    static int
+alcove_bridge_flush(alcove_state_t *ap, alcove_child_t *c)
+{
+    alcove_bridge_t *b = c->bridge;
+    ssize_t n = 0;
+
+    /* stdout -> socket */
+    while (b->outoff < b->outlen) {
+        n = alcove_bridge_send(b->fd, b->outbuf + b->outoff,
+                b->outlen - b->outoff);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return alcove_bridge_close(ap, c, errno);
+        }
+
+        b->outoff += n;
+        b->out += n;
+    }
+
+    if (b->outoff == b->outlen)
+        b->outlen = b->outoff = 0;
+
+    /* socket -> stdin */
+    while (c->fdin > -1 && b->inoff < b->inlen) {
+        n = write(c->fdin, b->inbuf + b->inoff, b->inlen - b->inoff);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            /* the child has closed stdin: the data is discarded */
+            (void)close(c->fdin);
+            c->fdin = -1;
+            break;
+        }
+
+        b->inoff += n;
+        b->in += n;
+    }
+
+    if (b->inoff == b->inlen || c->fdin < 0)
+        b->inlen = b->inoff = 0;
+
+    /* the peer has closed the socket: the child reads EOF */
+    if ((b->flags & ALCOVE_BRIDGE_IN_EOF) && b->inlen == 0 && c->fdin > -1) {
+        (void)close(c->fdin);
+        c->fdin = -1;
+    }
+
+    if ((b->flags & ALCOVE_BRIDGE_OUT_EOF) && b->outlen == 0
+            && !(b->flags & ALCOVE_BRIDGE_OUT_SHUT)) {
+        (void)shutdown(b->fd, SHUT_WR);
+        b->flags |= ALCOVE_BRIDGE_OUT_SHUT;
+    }
+
+    if (c->fdin < 0 && (b->flags & ALCOVE_BRIDGE_OUT_SHUT))
+        return alcove_bridge_close(ap, c, 0);
+
+    return 0;
+}
+
+    static ssize_t
+alcove_bridge_send(int fd, const void *buf, size_t len)
+{
+#ifdef MSG_NOSIGNAL
+    ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+
+    if (n >= 0 || errno != ENOTSOCK)
+        return n;
+#endif
+
+    return write(fd, buf, len);
+}
+
+/*
+ * Close the socket and send an event:
+ *
+ *  {bridge_closed, In, Out} | {bridge_error, posix()}
+ *
+ * After an error, stdout of the child is sent to the port.
+ */
+    static int
+alcove_bridge_close(alcove_state_t *ap, alcove_child_t *c, int errnum)
+{
+    alcove_bridge_t *b = c->bridge;
+    int index = 0;
+    char t[MAXMSGLEN] = {0};
+
+    UNUSED(ap);
+
+    (void)close(b->fd);
+
+    if (errnum == 0) {
+        ALCOVE_TUPLE3(t, sizeof(t), &index,
+            "bridge_closed",
+            alcove_encode_ulonglong(t, sizeof(t), &index, b->in),
+            alcove_encode_ulonglong(t, sizeof(t), &index, b->out)
+        );
+    }
+    else {
+        ALCOVE_TUPLE2(t, sizeof(t), &index,
+            "bridge_error",
+            alcove_encode_atom(t, sizeof(t), &index, erl_errno_id(errnum))
+        );
+    }
+
+    free(b);
+    c->bridge = NULL;
+
+    return alcove_call_spoof(c->pid, ALCOVE_MSG_EVENT, t, index) < 0 ? -1 : 0;
+}
+
+/*
+ * Watched descriptors
+ *
+ * {fd_ready, FD, [read | write | hup | err | nval]}
+ *
+ * Hangups and errors are reported for all watched descriptors. A
+ * descriptor that is not open is removed.
+ *
+ * Events are level triggered: a persistent watch is disarmed after
+ * sending an event and re-armed when the process runs a call,
+ * usually to read or write the descriptor. At most one event is sent
+ * for each call while the descriptor stays ready.
+ */
+    static int
+alcove_watch_event(alcove_state_t *ap, struct pollfd *fds)
+{
+    int i = 0;
+
+    for (i = 0; i < ap->maxfd; i++) {
+        if (ap->watch[i] == 0 || (ap->watch[i] & ALCOVE_WATCH_DISARMED)
+                || fds[i].revents == 0)
+            continue;
+
+        if (alcove_watch_ready(i, fds[i].revents) < 0)
+            return -1;
+
+        if ((ap->watch[i] & ALCOVE_WATCH_ONESHOT)
+                || (fds[i].revents & POLLNVAL))
+            ap->watch[i] = 0;
+        else
+            ap->watch[i] |= ALCOVE_WATCH_DISARMED;
+    }
+
+    return 0;
+}
+
+    static int
+alcove_watch_ready(int fd, short revents)
+{
+    int index = 0;
+    int n = 0;
+    char t[MAXMSGLEN] = {0};
+
+    n = ((revents & POLLIN) ? 1 : 0) + ((revents & POLLOUT) ? 1 : 0)
+        + ((revents & POLLHUP) ? 1 : 0) + ((revents & POLLERR) ? 1 : 0)
+        + ((revents & POLLNVAL) ? 1 : 0);
+
+    ALCOVE_ERR(alcove_encode_version(t, sizeof(t), &index));
+    ALCOVE_ERR(alcove_encode_tuple_header(t, sizeof(t), &index, 3));
+    ALCOVE_ERR(alcove_encode_atom(t, sizeof(t), &index, "fd_ready"));
+    ALCOVE_ERR(alcove_encode_long(t, sizeof(t), &index, fd));
+    ALCOVE_ERR(alcove_encode_list_header(t, sizeof(t), &index, n));
+    if (revents & POLLIN)
+        ALCOVE_ERR(alcove_encode_atom(t, sizeof(t), &index, "read"));
+    if (revents & POLLOUT)
+        ALCOVE_ERR(alcove_encode_atom(t, sizeof(t), &index, "write"));
+    if (revents & POLLHUP)
+        ALCOVE_ERR(alcove_encode_atom(t, sizeof(t), &index, "hup"));
+    if (revents & POLLERR)
+        ALCOVE_ERR(alcove_encode_atom(t, sizeof(t), &index, "err"));
+    if (revents & POLLNVAL)
+        ALCOVE_ERR(alcove_encode_atom(t, sizeof(t), &index, "nval"));
+    ALCOVE_ERR(alcove_encode_empty_list(t, sizeof(t), &index));
+
+    return alcove_call_reply(ALCOVE_MSG_EVENT, t, index) < 0 ? -1 : 0;
+}
+
+/*
+ * Read the signals caught since the last iteration, up to
+ * ALCOVE_SIGBATCH signals. Coalesced signals are reported when the
+ * batch has been read.
+ */
     static int
 alcove_handle_signal(alcove_state_t *ap) {
     siginfo_t info = {0};
-    int status = 0;
     ssize_t n = 0;
+    int i = 0;
 
-    errno = 0;
-    n = read(ALCOVE_SIGREAD_FILENO, &info, sizeof(info));
+    for (i = 0; i < ALCOVE_SIGBATCH; i++) {
+        errno = 0;
+        n = read(ALCOVE_SIGREAD_FILENO, &info, sizeof(info));
+
+        if (n != sizeof(info)) {
+            if (errno == EAGAIN || errno == EINTR)
+                break;
+            return -1;
+        }
 
-    if (n != sizeof(info))
-        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+        if (info.si_signo != SIGCHLD || ap->sigchld) {
+            if (alcove_signal_event(ap, &info) < 0)
+                return -1;
+        }
+        else if (alcove_offload_waitpid())
+            ap->reap = 1;
+        else if (alcove_reap(ap) < 0)
+            return -1;
+    }
 
-    if (info.si_signo != SIGCHLD || ap->sigchld)
-        return alcove_signal_event(ap, &info);
+    return alcove_signal_flush(ap);
+}
+
+/*
+ * Reap exited children. If exit_rusage is set, the resource usage of
+ * the child is retrieved using wait4(2).
+ */
+    static int
+alcove_reap(alcove_state_t *ap) {
+    alcove_exit_t exited[ALCOVE_EXITBATCH];
+    int n = 0;
 
     for ( ; ; ) {
+        alcove_exit_t *e = &exited[n];
         pid_t pid = 0;
 
-        pid = waitpid(-1, &status, WNOHANG);
+        (void)memset(e, 0, sizeof(alcove_exit_t));
+
+        pid = (ap->opt & alcove_opt_exit_rusage)
+            ? wait4(-1, &e->status, WNOHANG, &e->ru)
+            : waitpid(-1, &e->status, WNOHANG);
 
         if (errno == ECHILD || pid == 0)
-            return 0;
+            break;
 
         if (pid < 0)
             return -1;
 
-        (void)pid_foreach(ap, pid, &status, NULL, pid_equal, exited_pid);
+        e->pid = pid;
+
+        if (pid_foreach(ap, pid, e, NULL, pid_equal, exited_pid) != 0
+                || !(ap->opt & alcove_opt_exit_batch))
+            continue;
+
+        if (++n == ALCOVE_EXITBATCH) {
+            if (alcove_exit_batch(ap, exited, n) < 0)
+                return -1;
+            n = 0;
+        }
+    }
+
+    return alcove_exit_batch(ap, exited, n);
+}
+
+/*
+ * {exited, [{Pid, {exit_status, Status} | {termsig, Signal}, Rusage}]}
+ *
+ * Rusage is an empty list unless exit_rusage is set.
+ */
+    static int
+alcove_exit_batch(alcove_state_t *ap, alcove_exit_t *exited, int n)
+{
+    int index = 0;
+    char t[MAXMSGLEN] = {0};
+    int i = 0;
+
+    if (n == 0)
+        return 0;
+
+    ALCOVE_ERR(alcove_encode_version(t, sizeof(t), &index));
+    ALCOVE_ERR(alcove_encode_tuple_header(t, sizeof(t), &index, 2));
+    ALCOVE_ERR(alcove_encode_atom(t, sizeof(t), &index, "exited"));
+    ALCOVE_ERR(alcove_encode_list_header(t, sizeof(t), &index, n));
+
+    for (i = 0; i < n; i++) {
+        ALCOVE_ERR(alcove_encode_tuple_header(t, sizeof(t), &index, 3));
+        ALCOVE_ERR(alcove_encode_long(t, sizeof(t), &index, exited[i].pid));
+        ALCOVE_ERR(alcove_exit_reason(t, sizeof(t), &index,
+                    exited[i].status));
+        if (ap->opt & alcove_opt_exit_rusage) {
+            ALCOVE_ERR(alcove_encode_rusage(t, sizeof(t), &index,
+                        &exited[i].ru));
+        }
+        else {
+            ALCOVE_ERR(alcove_encode_empty_list(t, sizeof(t), &index));
+        }
     }
 
+    ALCOVE_ERR(alcove_encode_empty_list(t, sizeof(t), &index));
+
+    return alcove_call_reply(ALCOVE_MSG_EVENT, t, index) < 0 ? -1 : 0;
+}
+
+    static int
+alcove_exit_reason(char *buf, size_t len, int *index, int status)
+{
+    ALCOVE_ERR(alcove_encode_tuple_header(buf, len, index, 2));
+
+    if (WIFSIGNALED(status)) {
+        ALCOVE_ERR(alcove_encode_atom(buf, len, index, "termsig"));
+        ALCOVE_ERR(alcove_signal_name(buf, len, index, WTERMSIG(status)));
+    }
+    else {
+        ALCOVE_ERR(alcove_encode_atom(buf, len, index, "exit_status"));
+        ALCOVE_ERR(alcove_encode_long(buf, len, index,
+                    WEXITSTATUS(status)));
+    }
+
+    return 0;
+}
+
+/*
+ * [{utime, Usec}, {stime, Usec}, {maxrss, N}, {minflt, N}, {majflt, N},
+ *  {nvcsw, N}, {nivcsw, N}]
+ */
+    static int
+alcove_encode_rusage(char *buf, size_t len, int *index, struct rusage *ru)
+{
+    struct {
+        char *name;
+        long long val;
+    } field[] = {
+        {"utime", (long long)ru->ru_utime.tv_sec * 1000000
+            + ru->ru_utime.tv_usec},
+        {"stime", (long long)ru->ru_stime.tv_sec * 1000000
+            + ru->ru_stime.tv_usec},
+        {"maxrss", ru->ru_maxrss},
+        {"minflt", ru->ru_minflt},
+        {"majflt", ru->ru_majflt},
+        {"nvcsw", ru->ru_nvcsw},
+        {"nivcsw", ru->ru_nivcsw},
+    };
+    int i = 0;
+    int n = sizeof(field) / sizeof(field[0]);
+
+    ALCOVE_ERR(alcove_encode_list_header(buf, len, index, n));
+
+    for (i = 0; i < n; i++) {
+        ALCOVE_ERR(alcove_encode_tuple_header(buf, len, index, 2));
+        ALCOVE_ERR(alcove_encode_atom(buf, len, index, field[i].name));
+        ALCOVE_ERR(alcove_encode_longlong(buf, len, index, field[i].val));
+    }
+
+    ALCOVE_ERR(alcove_encode_empty_list(buf, len, index));
+
     return 0;
 }
 
+/*
+ * {signal, Name, Info}
+ *
+ * Info is the siginfo_t structure or an empty binary if the signal
+ * was set to nosiginfo.
+ */
     static int
 alcove_signal_event(alcove_state_t *ap, siginfo_t *info) {
     int index = 0;
     char reply[MAXMSGLEN] = {0};
+    alcove_sigevent_t *s = NULL;
+    size_t infolen = sizeof(siginfo_t);
+
+    if (info->si_signo > 0 && info->si_signo < ALCOVE_NSIG) {
+        s = &ap->sigevent[info->si_signo];
+
+        if (s->flags & ALCOVE_SIGEVENT_FIRST) {
+            if (s->flags & ALCOVE_SIGEVENT_FIRED)
+                return 0;
+            s->flags |= ALCOVE_SIGEVENT_FIRED;
+        }
+
+        if (s->flags & ALCOVE_SIGEVENT_COALESCE) {
+            s->count++;
+            s->info = *info;
+            return 0;
+        }
+
+        if (s->flags & ALCOVE_SIGEVENT_NOSIGINFO)
+            infolen = 0;
+    }
 
     ALCOVE_TUPLE3(reply, sizeof(reply), &index,
         "signal",
         alcove_signal_name(reply, sizeof(reply), &index, info->si_signo),
-        alcove_encode_binary(reply, sizeof(reply), &index,
-            info, (info == NULL ? 0 : sizeof(siginfo_t)))
+        alcove_encode_binary(reply, sizeof(reply), &index, info, infolen)
     );
 
     if (alcove_call_reply(ALCOVE_MSG_EVENT, reply, index) < 0)
@@ -728,3 +2081,38 @@ alcove_signal_event(alcove_state_t *ap, siginfo_t *info) {
 
     return 0;
 };
+
+/*
+ * {signal, Name, Info, Count}
+ *
+ * Info is the siginfo_t of the last signal coalesced.
+ */
+    static int
+alcove_signal_flush(alcove_state_t *ap) {
+    int index = 0;
+    char reply[MAXMSGLEN] = {0};
+    int sig = 0;
+
+    for (sig = 1; sig < ALCOVE_NSIG; sig++) {
+        alcove_sigevent_t *s = &ap->sigevent[sig];
+
+        if (s->count == 0)
+            continue;
+
+        ALCOVE_TUPLE4(reply, sizeof(reply), &index,
+            "signal",
+            alcove_signal_name(reply, sizeof(reply), &index, sig),
+            alcove_encode_binary(reply, sizeof(reply), &index, &s->info,
+                (s->flags & ALCOVE_SIGEVENT_NOSIGINFO)
+                ? 0 : sizeof(siginfo_t)),
+            alcove_encode_ulong(reply, sizeof(reply), &index, s->count)
+        );
+
+        s->count = 0;
+
+        if (alcove_call_reply(ALCOVE_MSG_EVENT, reply, index) < 0)
+            return -1;
+    }
+
+    return 0;
+}
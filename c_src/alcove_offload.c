@@ -0,0 +1,359 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+#include <pthread.h>
+
+/*
+ * Offloaded calls
+ *
+ * When the offload option is set, calls that may block indefinitely
+ * run in a worker thread. The event loop continues to forward the
+ * output and events of child processes while the call runs and sends
+ * the reply when the worker has finished.
+ *
+ * A single call is in progress. The event loop continues to read
+ * stdin: data and calls for child processes are forwarded while calls
+ * for this process are queued and run after the reply has been sent.
+ * Replies are returned in order and the per-call arena is only used
+ * by one thread at a time.
+ *
+ * The worker is started on first use. A child process does not
+ * inherit the worker and starts its own: see alcove_offload_reset().
+ */
+#define ALCOVE_OFFLOAD_STACKSIZE    (1024 * 1024)
+
+typedef struct {
+    pthread_t tid;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int started;
+    int pending;    /* request waiting for the worker */
+    int done;       /* reply waiting for the event loop */
+    int busy;       /* request sent to the worker, reply not sent */
+    int fd[2];      /* worker -> event loop */
+    alcove_state_t *ap;
+    u_int16_t type;
+    u_int16_t call;
+    size_t len;
+    ssize_t rlen;
+    pid_t exited;   /* child reaped by waitpid() in the worker */
+    char arg[MAXMSGLEN];
+    char reply[MAXMSGLEN];
+} alcove_offload_t;
+
+static alcove_offload_msg_t *offload_queue = NULL;
+static alcove_offload_msg_t **offload_tail = &offload_queue;
+
+static alcove_offload_t offload = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .fd = {-1, -1}
+};
+
+static int alcove_offload_blocking(u_int16_t call);
+static int alcove_offload_start(void);
+static void *alcove_offload_worker(void *arg);
+
+/* Returns 1 if the call was sent to the worker */
+    int
+alcove_offload_call(alcove_state_t *ap, u_int16_t type, u_int16_t call,
+        const char *arg, size_t len)
+{
+    if (!(ap->opt & alcove_opt_offload) || !alcove_offload_blocking(call))
+        return 0;
+
+    if (len > sizeof(offload.arg))
+        return 0;
+
+    /* run the call in the event loop if the worker cannot be started */
+    if (!offload.started && alcove_offload_start() < 0)
+        return 0;
+
+    (void)pthread_mutex_lock(&offload.lock);
+
+    (void)memcpy(offload.arg, arg, len);
+    offload.ap = ap;
+    offload.type = type;
+    offload.call = call;
+    offload.len = len;
+    offload.exited = 0;
+    offload.pending = 1;
+    offload.done = 0;
+    offload.busy = 1;
+
+    (void)pthread_cond_signal(&offload.cond);
+    (void)pthread_mutex_unlock(&offload.lock);
+
+    return 1;
+}
+
+/* Descriptor signalled by the worker when a reply is ready */
+    int
+alcove_offload_fd(void)
+{
+    return offload.busy ? offload.fd[0] : -1;
+}
+
+/* Returns 1 if the descriptor is the pipe between the worker and the
+ * event loop */
+    int
+alcove_offload_pipe(int fd)
+{
+    return offload.started && (fd == offload.fd[0] || fd == offload.fd[1]);
+}
+
+    int
+alcove_offload_busy(void)
+{
+    return offload.busy;
+}
+
+/* Returns 1 if the worker is waiting for a child: exited children are
+ * reaped by the event loop after the call has returned */
+    int
+alcove_offload_waitpid(void)
+{
+    return offload.busy && offload.call == ALCOVE_CALL_WAITPID;
+}
+
+/* Returns 1 if the caller is running in the worker */
+    int
+alcove_offload_self(void)
+{
+    return offload.started && pthread_equal(pthread_self(), offload.tid);
+}
+
+/* The table of children is only modified by the event loop: a child
+ * reaped by the worker is removed when the reply is sent */
+    void
+alcove_offload_exited(pid_t pid)
+{
+    offload.exited = pid;
+}
+
+/* Calls are queued while the worker is busy or calls are waiting */
+    int
+alcove_offload_queued(void)
+{
+    return offload.busy || offload_queue != NULL;
+}
+
+    int
+alcove_offload_enqueue(u_int16_t type, const unsigned char *buf,
+        u_int16_t len)
+{
+    alcove_offload_msg_t *msg = NULL;
+
+    msg = malloc(sizeof(alcove_offload_msg_t) + len);
+    if (msg == NULL)
+        return -1;
+
+    msg->next = NULL;
+    msg->type = type;
+    msg->len = len;
+    (void)memcpy(msg->buf, buf, len);
+
+    *offload_tail = msg;
+    offload_tail = &msg->next;
+
+    return 0;
+}
+
+/* Returns the next queued call: the caller frees the message */
+    alcove_offload_msg_t *
+alcove_offload_dequeue(void)
+{
+    alcove_offload_msg_t *msg = offload_queue;
+
+    if (msg == NULL)
+        return NULL;
+
+    offload_queue = msg->next;
+    if (offload_queue == NULL)
+        offload_tail = &offload_queue;
+
+    return msg;
+}
+
+    int
+alcove_offload_reply(void)
+{
+    char c = 0;
+    int done = 0;
+
+    if (read(offload.fd[0], &c, 1) < 0)
+        return (errno == EINTR || errno == EAGAIN) ? 0 : -1;
+
+    (void)pthread_mutex_lock(&offload.lock);
+    done = offload.done;
+    offload.done = 0;
+    (void)pthread_mutex_unlock(&offload.lock);
+
+    if (!done)
+        return 0;
+
+    offload.busy = 0;
+
+    /* see alcove_msg_call() */
+    if (offload.rlen < 0)
+        return -1;
+
+    if (offload.exited > 0
+            && alcove_waitpid_remove(offload.ap, offload.exited) < 0)
+        return -1;
+
+    if (alcove_call_error(offload.type, offload.reply, offload.rlen))
+        offload.ap->stats.errors++;
+
+    return alcove_call_reply(offload.type, offload.reply, offload.rlen) < 0
+        ? -1
+        : 0;
+}
+
+    static int
+alcove_offload_blocking(u_int16_t call)
+{
+    switch (call) {
+        case ALCOVE_CALL_CONNECT:
+        case ALCOVE_CALL_COPY_FILE_RANGE:
+        case ALCOVE_CALL_COPYFILE:
+        case ALCOVE_CALL_MOUNT:
+        case ALCOVE_CALL_OPEN:
+        case ALCOVE_CALL_PREAD:
+        case ALCOVE_CALL_PREADV:
+        case ALCOVE_CALL_READ:
+        case ALCOVE_CALL_READFILE:
+        case ALCOVE_CALL_SELECT:
+        case ALCOVE_CALL_SENDFILE:
+        case ALCOVE_CALL_SPLICE:
+        case ALCOVE_CALL_UMOUNT:
+        case ALCOVE_CALL_WAITPID:
+        case ALCOVE_CALL_WRITE:
+        case ALCOVE_CALL_WRITEFILE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+    static int
+alcove_offload_start(void)
+{
+    pthread_attr_t attr;
+    sigset_t set;
+    sigset_t oset;
+    int rv = 0;
+
+    if (pipe(offload.fd) < 0)
+        return -1;
+
+    if ( (alcove_setfd(offload.fd[0], FD_CLOEXEC|O_NONBLOCK) < 0)
+            || (alcove_setfd(offload.fd[1], FD_CLOEXEC) < 0))
+        goto ERR;
+
+    if (pthread_attr_init(&attr) != 0)
+        goto ERR;
+
+    (void)pthread_attr_setstacksize(&attr, ALCOVE_OFFLOAD_STACKSIZE);
+    (void)pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    /* signals are handled by the event loop */
+    (void)sigfillset(&set);
+    (void)pthread_sigmask(SIG_SETMASK, &set, &oset);
+
+    rv = pthread_create(&offload.tid, &attr, alcove_offload_worker, NULL);
+
+    (void)pthread_sigmask(SIG_SETMASK, &oset, NULL);
+    (void)pthread_attr_destroy(&attr);
+
+    if (rv != 0)
+        goto ERR;
+
+    offload.started = 1;
+    return 0;
+
+ERR:
+    (void)close(offload.fd[0]);
+    (void)close(offload.fd[1]);
+    offload.fd[0] = -1;
+    offload.fd[1] = -1;
+    return -1;
+}
+
+    static void *
+alcove_offload_worker(void *arg)
+{
+    UNUSED(arg);
+
+    for ( ; ; ) {
+        (void)pthread_mutex_lock(&offload.lock);
+        while (!offload.pending)
+            (void)pthread_cond_wait(&offload.cond, &offload.lock);
+        offload.pending = 0;
+        (void)pthread_mutex_unlock(&offload.lock);
+
+        offload.rlen = (offload.type == ALCOVE_MSG_RAWCALL)
+            ? alcove_rawcall(offload.ap, offload.call,
+                offload.arg, offload.len, offload.reply,
+                ALCOVE_MSGLEN(offload.ap->depth, sizeof(offload.reply)))
+            : alcove_call(offload.ap, offload.call,
+                offload.arg, offload.len, offload.reply,
+                ALCOVE_MSGLEN(offload.ap->depth, sizeof(offload.reply)));
+
+        (void)pthread_mutex_lock(&offload.lock);
+        offload.done = 1;
+        (void)pthread_mutex_unlock(&offload.lock);
+
+        while (write(offload.fd[1], "", 1) < 0) {
+            if (errno != EINTR)
+                exit(errno);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Called in a new child process. Calls are not run by the event loop
+ * while the worker is busy: when the parent forked, the worker was
+ * waiting for a request and did not hold the lock.
+ */
+    void
+alcove_offload_reset(void)
+{
+    alcove_offload_msg_t *msg = NULL;
+
+    /* queued calls were sent to the parent */
+    while ( (msg = alcove_offload_dequeue()) != NULL)
+        free(msg);
+
+    if (!offload.started)
+        return;
+
+    (void)close(offload.fd[0]);
+    (void)close(offload.fd[1]);
+
+    (void)pthread_mutex_init(&offload.lock, NULL);
+    (void)pthread_cond_init(&offload.cond, NULL);
+
+    offload.fd[0] = -1;
+    offload.fd[1] = -1;
+    offload.started = 0;
+    offload.pending = 0;
+    offload.done = 0;
+    offload.busy = 0;
+}
@@ -0,0 +1,88 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+/*
+ * Calls with a fixed layout: the arguments are native integers
+ * followed by an optional payload. The reply is a tagged native
+ * value instead of external term format.
+ *
+ *  read: |fd:4|count:8|
+ *  write: |fd:4|data:...|
+ */
+    ssize_t
+alcove_rawcall(alcove_state_t *ap, u_int32_t call,
+        const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    ssize_t written = 0;
+
+    switch (call) {
+        case ALCOVE_CALL_READ:
+            written = alcove_raw_read(ap, arg, len, reply, rlen);
+            break;
+
+        case ALCOVE_CALL_WRITE:
+            written = alcove_raw_write(ap, arg, len, reply, rlen);
+            break;
+
+        default:
+            written = -1;
+            break;
+    }
+
+    if (written < 0)
+        return alcove_raw_atom(reply, rlen, "badarg");
+
+    return written;
+}
+
+    ssize_t
+alcove_raw_atom(char *buf, size_t len, const char *atom)
+{
+    size_t n = strlen(atom);
+
+    if (n + 1 > len)
+        return -1;
+
+    buf[0] = ALCOVE_RAW_ATOM;
+    (void)memcpy(buf + 1, atom, n);
+
+    return n + 1;
+}
+
+    ssize_t
+alcove_raw_errno(char *buf, size_t len, int errnum)
+{
+    ssize_t n = alcove_raw_atom(buf, len, erl_errno_id(errnum));
+
+    if (n > 0)
+        buf[0] = ALCOVE_RAW_ERROR;
+
+    return n;
+}
+
+    ssize_t
+alcove_raw_int64(char *buf, size_t len, int64_t val)
+{
+    if (len < 1 + sizeof(val))
+        return -1;
+
+    buf[0] = ALCOVE_RAW_INT64;
+    (void)memcpy(buf + 1, &val, sizeof(val));
+
+    return 1 + sizeof(val);
+}
@@ -0,0 +1,161 @@
+/* Copyright (c) 2014, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+
+#include <time.h>
+
+/*
+ * Timers
+ *
+ * Deadlines of child processes, the flush deadline of buffered child
+ * stdout and timers started by timer_start/2 are checked by the event
+ * loop. The poll(2) timeout is the time
+ * until the next expiry, in milliseconds.
+ */
+static int child_deadline(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2);
+static int child_expire(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2);
+static int alcove_timer_event(u_int32_t id);
+
+    u_int64_t
+alcove_timer_now(void)
+{
+    struct timespec ts = {0};
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+        exit(errno);
+
+    return (u_int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Returns the poll(2) timeout: -1 if no timers are running */
+    int
+alcove_timer_timeout(alcove_state_t *ap)
+{
+    u_int64_t next = 0;
+    u_int64_t now = 0;
+    int i = 0;
+
+    for (i = 0; i < ALCOVE_MAXTIMER; i++) {
+        if (ap->timer[i].id != 0
+                && (next == 0 || ap->timer[i].expires < next))
+            next = ap->timer[i].expires;
+    }
+
+    (void)pid_foreach(ap, 0, &next, NULL, pid_not_equal, child_deadline);
+
+    if (next == 0)
+        return -1;
+
+    now = alcove_timer_now();
+
+    if (next <= now)
+        return 0;
+
+    return (next - now > INT_MAX) ? INT_MAX : (int)(next - now);
+}
+
+    int
+alcove_timer_expire(alcove_state_t *ap)
+{
+    u_int64_t now = alcove_timer_now();
+    int i = 0;
+
+    if (pid_foreach(ap, 0, &now, NULL, pid_not_equal, child_expire) < 0)
+        return -1;
+
+    for (i = 0; i < ALCOVE_MAXTIMER; i++) {
+        alcove_timer_t *t = &ap->timer[i];
+        u_int32_t id = t->id;
+
+        if (id == 0 || t->expires > now)
+            continue;
+
+        if (t->interval == 0)
+            t->id = 0;
+        else {
+            t->expires += t->interval;
+            /* skip intervals missed while the process was busy */
+            if (t->expires <= now)
+                t->expires = now + t->interval;
+        }
+
+        if (alcove_timer_event(id) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+    static int
+child_deadline(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
+{
+    u_int64_t *next = arg1;
+    u_int64_t flush = 0;
+
+    UNUSED(arg2);
+
+    if (c->deadline != 0 && !c->exited
+            && (*next == 0 || c->deadline < *next))
+        *next = c->deadline;
+
+    if (ap->stdout_flush_ms > 0 && c->outbuf != NULL && c->outbuf->len > 0) {
+        flush = c->outbuf->since + ap->stdout_flush_ms;
+        if (*next == 0 || flush < *next)
+            *next = flush;
+    }
+
+    return 1;
+}
+
+    static int
+child_expire(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
+{
+    u_int64_t *now = arg1;
+
+    UNUSED(arg2);
+
+    if (ap->stdout_flush_ms > 0 && c->outbuf != NULL && c->outbuf->len > 0
+            && c->outbuf->since + ap->stdout_flush_ms <= *now) {
+        if (alcove_child_flush(ap, c, 0) < 0)
+            return -1;
+    }
+
+    if (c->deadline == 0 || c->deadline > *now)
+        return 1;
+
+    c->deadline = 0;
+
+    if (!c->exited)
+        (void)kill(c->pid, c->deadline_sig);
+
+    return 1;
+}
+
+/* {timer, Id} */
+    static int
+alcove_timer_event(u_int32_t id)
+{
+    int index = 0;
+    char t[MAXMSGLEN] = {0};
+
+    ALCOVE_TUPLE2(t, sizeof(t), &index,
+        "timer",
+        alcove_encode_ulong(t, sizeof(t), &index, id)
+    );
+
+    return alcove_call_reply(ALCOVE_MSG_EVENT, t, index) < 0 ? -1 : 0;
+}
@@ -0,0 +1,30 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+static const alcove_constant_t alcove_at_constants[] = {
+#ifdef AT_FDCWD
+    ALCOVE_CONSTANT(AT_FDCWD),
+#endif
+#ifdef AT_SYMLINK_NOFOLLOW
+    ALCOVE_CONSTANT(AT_SYMLINK_NOFOLLOW),
+#endif
+#ifdef AT_EMPTY_PATH
+    ALCOVE_CONSTANT(AT_EMPTY_PATH),
+#endif
+#ifdef AT_NO_AUTOMOUNT
+    ALCOVE_CONSTANT(AT_NO_AUTOMOUNT),
+#endif
+
+    {NULL, 0}
+};
@@ -0,0 +1,130 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+
+/* size of the buffer used to copy with read/write */
+#define ALCOVE_COPY_BUFSZ   65536
+
+/* The kernel does not support copying between these descriptors. Other
+ * errors, including EINVAL for invalid arguments, are returned. */
+#define ALCOVE_COPY_FALLBACK(_e) \
+    ((_e) == ENOSYS || (_e) == EXDEV || (_e) == EOPNOTSUPP || (_e) == ENOTSUP)
+
+/*
+ * Copy data between file descriptors without passing through the port
+ * buffers. An offset of NULL uses and updates the file offset.
+ *
+ * Returns the number of bytes copied or 0 at the end of file.
+ */
+    ssize_t
+alcove_copy(int in, off_t *offin, int out, off_t *offout, size_t len)
+{
+#if defined(__linux__) && defined(SYS_copy_file_range)
+    /* Set when the kernel returns ENOSYS: later copies go straight to
+     * read/write. The flag is process global and is inherited by forked
+     * children, which run on the same kernel. Calls are serialized, so
+     * only the thread running the copy writes it. */
+    static int nocopy = 0;
+    loff_t li = 0;
+    loff_t lo = 0;
+    long n = 0;
+
+    if (!nocopy) {
+        if (offin != NULL)
+            li = *offin;
+        if (offout != NULL)
+            lo = *offout;
+
+        n = syscall(SYS_copy_file_range, in, (offin ? &li : NULL),
+                out, (offout ? &lo : NULL), len, 0);
+
+        if (n >= 0) {
+            if (offin != NULL)
+                *offin = li;
+            if (offout != NULL)
+                *offout = lo;
+            return n;
+        }
+
+        if (!ALCOVE_COPY_FALLBACK(errno))
+            return -1;
+
+        if (errno == ENOSYS)
+            nocopy = 1;
+    }
+#endif
+
+    return alcove_copy_rw(in, offin, out, offout, len);
+}
+
+    ssize_t
+alcove_sendfile(int out, int in, off_t *offset, size_t len)
+{
+#ifdef __linux__
+    ssize_t n = sendfile(out, in, offset, len);
+
+    if (n >= 0 || !ALCOVE_COPY_FALLBACK(errno))
+        return n;
+#endif
+
+    return alcove_copy_rw(in, offset, out, NULL, len);
+}
+
+/* Copy one buffer of data using read(2) and write(2) */
+    ssize_t
+alcove_copy_rw(int in, off_t *offin, int out, off_t *offout, size_t len)
+{
+    /* reserved space is reused by each call */
+    char *buf = alcove_arena_reserve(ALCOVE_COPY_BUFSZ);
+    ssize_t n = 0;
+    ssize_t total = 0;
+
+    len = MIN(len, ALCOVE_COPY_BUFSZ);
+
+    do {
+        n = (offin != NULL)
+            ? pread(in, buf, len, *offin)
+            : read(in, buf, len);
+    } while (n < 0 && errno == EINTR);
+
+    if (n <= 0)
+        return n;
+
+    while (total < n) {
+        ssize_t w = (offout != NULL)
+            ? pwrite(out, buf + total, n - total, *offout + total)
+            : write(out, buf + total, n - total);
+
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+
+        total += w;
+    }
+
+    if (offin != NULL)
+        *offin += n;
+    if (offout != NULL)
+        *offout += n;
+
+    return n;
+}
@@ -22,6 +22,7 @@
 static int alcove_set_cloexec(int fd);
 static int alcove_close_pipe(int fd[2]);
 static int alcove_close_fd(int fd);
+static int alcove_stdio_dup(int fd);
 static int stdio_pid(alcove_state_t *ap, alcove_child_t *c,
         void *arg1, void *arg2);
 static int close_parent_fd(alcove_state_t *ap, alcove_child_t *c,
@@ -33,6 +34,8 @@ static int close_parent_fd(alcove_state_t *ap, alcove_child_t *c,
     int
 alcove_stdio(alcove_stdio_t *fd)
 {
+    fd->redirect[0] = fd->redirect[1] = fd->redirect[2] = -1;
+
     if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd->ctl) < 0)
         return -1;
 
@@ -76,6 +79,36 @@ alcove_close_fd(int fd)
     return 0;
 }
 
+/*
+ * The stdin of a child is non-blocking in the parent. The flag is
+ * shared with duplicated descriptors: on Linux, the pipe is opened
+ * again to get a blocking descriptor for the exec'ed process.
+ */
+    static int
+alcove_stdio_dup(int fd)
+{
+#ifdef __linux__
+    char path[32] = {0};
+    struct stat st = {0};
+    int flags = fcntl(fd, F_GETFL);
+    int nfd = -1;
+
+    if (flags >= 0 && (flags & O_NONBLOCK) && fstat(fd, &st) == 0
+            && S_ISFIFO(st.st_mode)) {
+        (void)snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+        nfd = open(path, (flags & O_ACCMODE)|O_CLOEXEC);
+
+        if (nfd >= 0) {
+            int dfd = fcntl(nfd, F_DUPFD_CLOEXEC, ALCOVE_MAXFILENO);
+            (void)close(nfd);
+            return dfd;
+        }
+    }
+#endif
+
+    return fcntl(fd, F_DUPFD_CLOEXEC, ALCOVE_MAXFILENO);
+}
+
     int
 alcove_child_fun(void *arg)
 {
@@ -84,6 +117,9 @@ alcove_child_fun(void *arg)
     alcove_stdio_t *fd = child_arg->fd;
     sigset_t *sigset = child_arg->sigset;
     int sigpipe[2] = {0};
+    int i = 0;
+
+    alcove_offload_reset();
 
     if (pipe(sigpipe) < 0)
         return -1;
@@ -103,6 +139,20 @@ alcove_child_fun(void *arg)
             || (dup2(fd->ctl[PIPE_READ], ALCOVE_FDCTL_FILENO) < 0))
         return -1;
 
+    /* The descriptors connected to stdio on exec are moved: the
+     * descriptors of the other children are closed below. */
+    for (i = 0; i < 3; i++) {
+        if (ap->stdio[i] >= 0)
+            (void)close(ap->stdio[i]);
+
+        ap->stdio[i] = (fd->redirect[i] < 0)
+            ? -1
+            : alcove_stdio_dup(fd->redirect[i]);
+
+        if (fd->redirect[i] >= 0 && ap->stdio[i] < 0)
+            return -1;
+    }
+
     if ( (alcove_close_pipe(fd->in) < 0)
             || (alcove_close_pipe(fd->out) < 0)
             || (alcove_close_pipe(fd->err) < 0)
@@ -167,6 +217,53 @@ avail_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
     return 1;
 }
 
+/*
+ * Connect the redirected descriptors to stdin, stdout and stderr before
+ * calling exec. Until exec succeeds, stdout is used for replies: the
+ * original descriptors are saved and restored if exec fails.
+ */
+    int
+alcove_stdio_redirect(alcove_state_t *ap, int saved[3])
+{
+    int i = 0;
+
+    for (i = 0; i < 3; i++)
+        saved[i] = -1;
+
+    for (i = 0; i < 3; i++) {
+        if (ap->stdio[i] < 0)
+            continue;
+
+        saved[i] = fcntl(i, F_DUPFD_CLOEXEC, ALCOVE_MAXFILENO);
+
+        if (saved[i] < 0 || dup2(ap->stdio[i], i) < 0) {
+            int errnum = errno;
+            alcove_stdio_restore(saved);
+            errno = errnum;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+    void
+alcove_stdio_restore(int saved[3])
+{
+    int i = 0;
+
+    for (i = 0; i < 3; i++) {
+        if (saved[i] < 0)
+            continue;
+
+        if (dup2(saved[i], i) < 0)
+            exit(errno);
+
+        (void)close(saved[i]);
+        saved[i] = -1;
+    }
+}
+
     static int
 stdio_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
 {
@@ -180,6 +277,16 @@ stdio_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
     c->fdin = fd->in[PIPE_WRITE];
     c->fdout = fd->out[PIPE_READ];
     c->fderr = fd->err[PIPE_READ];
+    c->bridge = NULL;
+    c->stdinq = NULL;
+    c->outbuf = NULL;
+    c->deadline = 0;
+    c->discard = 0;
+    c->nout = 0;
+    c->nerr = 0;
+    c->nread = 0;
+    c->nthrottle = 0;
+    c->nin = 0;
 
     return 0;
 }
@@ -196,5 +303,8 @@ close_parent_fd(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
     (void)alcove_close_fd(c->fdout);
     (void)alcove_close_fd(c->fderr);
 
+    if (c->bridge != NULL)
+        (void)alcove_close_fd(c->bridge->fd);
+
     return 1;
 }
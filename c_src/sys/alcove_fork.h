@@ -17,6 +17,8 @@ typedef struct {
     int in[2];
     int out[2];
     int err[2];
+    /* descriptors connected to stdio when the process calls exec */
+    int redirect[3];
 } alcove_stdio_t;
 
 typedef struct {
@@ -29,3 +31,7 @@ int alcove_stdio(alcove_stdio_t *fd);
 int alcove_child_fun(void *arg);
 int alcove_parent_fd(alcove_state_t *ap, alcove_stdio_t *fd, pid_t pid);
 int avail_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2);
+ssize_t alcove_fork(alcove_state_t *ap, const int *redirect, char *reply,
+        size_t rlen);
+int alcove_stdio_redirect(alcove_state_t *ap, int saved[3]);
+void alcove_stdio_restore(int saved[3]);
@@ -17,22 +17,15 @@
 
 /* Probably only useful for testing */
     ssize_t
-alcove_sys_alloc(alcove_state_t *ap, const char *arg, size_t len,
-        char *reply, size_t rlen)
+alcove_sys_alloc(alcove_state_t *ap, char *buf, size_t size,
+        alcove_alloc_t *elem, ssize_t nelem, char *reply, size_t rlen)
 {
-    int index = 0;
     int rindex = 0;
-    char buf[MAXMSGLEN] = {0};
-    size_t size = sizeof(buf);
-    alcove_alloc_t *elem = NULL;
-    ssize_t nelem = 0;
 
     UNUSED(ap);
 
-    if (alcove_decode_cstruct(arg, len, &index, buf, &size,
-                &elem, &nelem) < 0)
-        return -1;
-
+    /* The memory referenced by {ptr, ...} outlives the call: the
+     * addresses are returned to the caller. */
     ALCOVE_TUPLE3(reply, rlen, &rindex,
         "ok",
         alcove_encode_binary(reply, rlen, &rindex, buf, size),
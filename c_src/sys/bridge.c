@@ -0,0 +1,83 @@
+/* Copyright (c) 2014, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+static int child_bridge(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2);
+
+/*
+ * bridge
+ *
+ * Relay data between a connected socket and the stdin and stdout of a
+ * child process. Data is relayed by the event loop after the child
+ * calls exec and does not pass through the port.
+ *
+ * The descriptor is owned by the bridge and is closed when both
+ * directions have reached EOF. The process is sent an event:
+ *
+ *  {bridge_closed, BytesIn, BytesOut} | {bridge_error, posix()}
+ *
+ */
+    ssize_t
+alcove_sys_bridge(alcove_state_t *ap, int pid, int fd,
+        char *reply, size_t rlen)
+{
+    alcove_bridge_t *b = NULL;
+    int flags = 0;
+    int rv = 0;
+
+    if (pid <= 0)
+        return alcove_mk_errno(reply, rlen, ESRCH);
+
+    flags = fcntl(fd, F_GETFL);
+    if (flags < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    b = calloc(1, sizeof(alcove_bridge_t));
+    if (b == NULL)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    b->fd = fd;
+
+    rv = pid_foreach(ap, pid, b, NULL, pid_equal, child_bridge);
+
+    if (rv != 0) {
+        free(b);
+        return alcove_mk_errno(reply, rlen, rv < 0 ? EBUSY : ESRCH);
+    }
+
+    (void)fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    return alcove_mk_atom(reply, rlen, "ok");
+}
+
+    static int
+child_bridge(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
+{
+    UNUSED(ap);
+    UNUSED(arg2);
+
+    if (c->exited)
+        return 1;
+
+    if (c->bridge != NULL)
+        return -1;
+
+    c->bridge = arg1;
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+static int child_counters(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2);
+
+/*
+ * child_stats
+ *
+ * Counters maintained by the event loop for a child process:
+ *
+ *  [{stdin, Bytes}, {stdout, Bytes}, {stderr, Bytes}, {reads, N},
+ *   {throttled, N}]
+ *
+ */
+    ssize_t
+alcove_sys_child_stats(alcove_state_t *ap, int pid,
+        char *reply, size_t rlen)
+{
+    alcove_child_t c = {0};
+    int rindex = 0;
+
+    if (pid <= 0 || pid_foreach(ap, pid, &c, NULL, pid_equal,
+                child_counters) != 0)
+        return alcove_mk_errno(reply, rlen, ESRCH);
+
+    ALCOVE_ERR(alcove_encode_version(reply, rlen, &rindex));
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "ok"));
+    ALCOVE_ERR(alcove_encode_list_header(reply, rlen, &rindex, 5));
+
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "stdin"));
+    ALCOVE_ERR(alcove_encode_ulonglong(reply, rlen, &rindex, c.nin));
+
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "stdout"));
+    ALCOVE_ERR(alcove_encode_ulonglong(reply, rlen, &rindex, c.nout));
+
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "stderr"));
+    ALCOVE_ERR(alcove_encode_ulonglong(reply, rlen, &rindex, c.nerr));
+
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "reads"));
+    ALCOVE_ERR(alcove_encode_ulonglong(reply, rlen, &rindex, c.nread));
+
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "throttled"));
+    ALCOVE_ERR(alcove_encode_ulonglong(reply, rlen, &rindex, c.nthrottle));
+
+    ALCOVE_ERR(alcove_encode_empty_list(reply, rlen, &rindex));
+
+    return rindex;
+}
+
+    static int
+child_counters(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
+{
+    alcove_child_t *counters = arg1;
+
+    UNUSED(ap);
+    UNUSED(arg2);
+
+    *counters = *c;
+
+    return 0;
+}
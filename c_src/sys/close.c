@@ -20,17 +20,10 @@
  *
  */
     ssize_t
-alcove_sys_close(alcove_state_t *ap, const char *arg, size_t len,
-        char *reply, size_t rlen)
+alcove_sys_close(alcove_state_t *ap, int fd, char *reply, size_t rlen)
 {
-    int index = 0;
-    int fd = 0;
-
-    UNUSED(ap);
-
-    /* fd */
-    if (alcove_decode_int(arg, len, &index, &fd) < 0)
-        return -1;
+    if (fd >= 0 && fd < ap->maxfd)
+        ap->watch[fd] = 0;
 
     return (close(fd) < 0)
         ? alcove_mk_errno(reply, rlen, errno)
@@ -0,0 +1,51 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+/*
+ * copy_file_range(2)
+ *
+ * An offset of -1 uses and updates the file offset. If the system
+ * does not support copy_file_range(2), the data is copied with
+ * read(2) and write(2).
+ *
+ */
+    ssize_t
+alcove_sys_copy_file_range(alcove_state_t *ap, int fdin, long long offin,
+        int fdout, long long offout, unsigned long long count,
+        char *reply, size_t rlen)
+{
+    int rindex = 0;
+    off_t oin = offin;
+    off_t oout = offout;
+    ssize_t rv = 0;
+
+    UNUSED(ap);
+
+    if (offin < -1 || offout < -1)
+        return -1;
+
+    rv = alcove_copy(fdin, (offin == -1) ? NULL : &oin,
+            fdout, (offout == -1) ? NULL : &oout, MIN(count, SSIZE_MAX));
+
+    if (rv < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    ALCOVE_OK(reply, rlen, &rindex,
+        alcove_encode_longlong(reply, rlen, &rindex, rv));
+
+    return rindex;
+}
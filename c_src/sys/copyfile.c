@@ -0,0 +1,128 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+#include "alcove_file_constants.h"
+
+#include <fcntl.h>
+
+/* bytes copied by each call to alcove_copy() */
+#define ALCOVE_COPYFILE_CHUNK   (1 << 30)
+
+/*
+ * copyfile
+ *
+ * Copy the contents of a file to another file. The destination file is
+ * opened for writing if the flags do not include an access mode. Files
+ * are created with the permissions of the source file, modified by the
+ * process umask. The setuid, setgid and sticky bits are not copied.
+ *
+ */
+    ssize_t
+alcove_sys_copyfile(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int index = 0;
+    int rindex = 0;
+    char src[PATH_MAX] = {0};
+    size_t slen = sizeof(src)-1;
+    char dst[PATH_MAX] = {0};
+    size_t dlen = sizeof(dst)-1;
+    int flags = 0;
+
+    int in = -1;
+    int out = -1;
+    struct stat st = {0};
+    long long total = 0;
+    ssize_t n = 0;
+    int errnum = 0;
+
+    UNUSED(ap);
+
+    /* src */
+    if (alcove_decode_iolist(arg, len, &index, src, &slen) < 0 ||
+            slen == 0)
+        return -1;
+
+    /* dst */
+    if (alcove_decode_iolist(arg, len, &index, dst, &dlen) < 0 ||
+            dlen == 0)
+        return -1;
+
+    /* flags */
+    switch (alcove_decode_constant_list(arg, len, &index, &flags,
+                alcove_file_constants)) {
+        case 0:
+            break;
+        case 1:
+            return alcove_mk_error(reply, rlen, "enotsup");
+        default:
+            return -1;
+    }
+
+    if ((flags & O_ACCMODE) == O_RDONLY)
+        flags |= O_WRONLY;
+
+    in = open(src, O_RDONLY|O_CLOEXEC);
+
+    if (in < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    if (fstat(in, &st) < 0) {
+        errnum = errno;
+        (void)close(in);
+        return alcove_mk_errno(reply, rlen, errnum);
+    }
+
+    out = open(dst, flags|O_CLOEXEC, st.st_mode & 0777);
+
+    if (out < 0) {
+        errnum = errno;
+        (void)close(in);
+        return alcove_mk_errno(reply, rlen, errnum);
+    }
+
+    for ( ; ; ) {
+        /* copy_file_range(2) returns EINVAL for special files */
+        n = S_ISREG(st.st_mode)
+            ? alcove_copy(in, NULL, out, NULL, ALCOVE_COPYFILE_CHUNK)
+            : alcove_copy_rw(in, NULL, out, NULL, ALCOVE_COPYFILE_CHUNK);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            errnum = errno;
+            break;
+        }
+
+        if (n == 0)
+            break;
+
+        total += n;
+    }
+
+    (void)close(in);
+
+    if (close(out) < 0 && errnum == 0)
+        errnum = errno;
+
+    if (errnum != 0)
+        return alcove_mk_errno(reply, rlen, errnum);
+
+    ALCOVE_OK(reply, rlen, &rindex,
+        alcove_encode_longlong(reply, rlen, &rindex, total));
+
+    return rindex;
+}
@@ -14,6 +14,7 @@
  */
 #include "alcove.h"
 #include "alcove_call.h"
+#include "alcove_fork.h"
 
 /*
  * execve(2)
@@ -29,10 +30,9 @@ alcove_sys_execve(alcove_state_t *ap, const char *arg, size_t len,
     size_t flen = sizeof(filename)-1;
     char **argv = NULL;
     char **envp = NULL;
+    int saved[3] = {0};
     int errnum = 0;
 
-    UNUSED(ap);
-
     /* filename */
     if (alcove_decode_iolist(arg, len, &index, filename, &flen) < 0 ||
             flen == 0)
@@ -46,12 +46,13 @@ alcove_sys_execve(alcove_state_t *ap, const char *arg, size_t len,
     if (alcove_decode_argv(arg, len, &index, &envp) < 0)
         return -1;
 
+    if (alcove_stdio_redirect(ap, saved) < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
     execve(filename, argv, envp);
 
     errnum = errno;
-
-    alcove_free_argv(argv);
-    alcove_free_argv(envp);
+    alcove_stdio_restore(saved);
 
     return alcove_mk_errno(reply, rlen, errnum);
 }
@@ -14,38 +14,26 @@
  */
 #include "alcove.h"
 #include "alcove_call.h"
+#include "alcove_fork.h"
 
 /*
  * execvp(3)
  *
  */
     ssize_t
-alcove_sys_execvp(alcove_state_t *ap, const char *arg, size_t len,
+alcove_sys_execvp(alcove_state_t *ap, const char *progname, char **argv,
         char *reply, size_t rlen)
 {
-    int index = 0;
-
-    char progname[PATH_MAX] = {0};
-    size_t plen = sizeof(progname)-1;
-    char **argv = NULL;
+    int saved[3] = {0};
     int errnum = 0;
 
-    UNUSED(ap);
-
-    /* progname */
-    if (alcove_decode_iolist(arg, len, &index, progname, &plen) < 0 ||
-            plen == 0)
-        return -1;
-
-    /* argv */
-    if (alcove_decode_argv(arg, len, &index, &argv) < 0)
-        return -1;
+    if (alcove_stdio_redirect(ap, saved) < 0)
+        return alcove_mk_errno(reply, rlen, errno);
 
     execvp(progname, argv);
 
     errnum = errno;
-
-    alcove_free_argv(argv);
+    alcove_stdio_restore(saved);
 
     return alcove_mk_errno(reply, rlen, errnum);
 }
@@ -0,0 +1,293 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+/* Space reserved in the reply for each child:
+ *     list header = 5 bytes
+ *     tuple header = 2 bytes
+ *     pid = 5 bytes
+ *     {error, etimedout} = 2 + 6 + 10 bytes
+ */
+#define ALCOVE_FANOUT_ENTRY 32
+
+static int alcove_fanout_call(int call);
+static int alcove_fanout_pids(const char *arg, size_t len, int *index,
+        pid_t **pids, int *npids);
+static int alcove_fanout_send(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2);
+static int alcove_fanout_recv(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2);
+
+typedef struct {
+    ssize_t rv;
+    int errnum;
+    char *reply;
+    size_t rlen;
+    u_int64_t deadline;
+} alcove_fanout_t;
+
+enum {
+    ALCOVE_FANOUT_ESRCH = 0,
+    ALCOVE_FANOUT_SENT,
+    ALCOVE_FANOUT_EPIPE,
+    ALCOVE_FANOUT_ENOTSUP
+};
+
+/*
+ * fanout
+ *
+ * Run a call in a list of children. The call is written to each child
+ * before any replies are read, so the children run the call
+ * concurrently.
+ *
+ * The replies are read until the fanout_timeout deadline: a child which
+ * has not replied returns {error, etimedout}.
+ *
+ */
+    ssize_t
+alcove_sys_fanout(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int index = 0;
+    int rindex = 0;
+
+    pid_t *pids = NULL;
+    int *status = NULL;
+    int npids = 0;
+    int call = 0;
+    unsigned char msg[MAXMSGLEN] = {0};
+    size_t msglen = 0;
+    char t[MAXMSGLEN] = {0};
+
+    alcove_fanout_t fanout = {0};
+
+    int type = 0;
+    int arity = 0;
+    int i = 0;
+
+    /* pids */
+    if (alcove_fanout_pids(arg, len, &index, &pids, &npids) < 0)
+        return -1;
+
+    /* call */
+    if (alcove_decode_int(arg, len, &index, &call) < 0
+            || alcove_fanout_call(call) < 0)
+        return -1;
+
+    /* argv: the call arguments in external term format */
+    if (alcove_get_type(arg, len, &index, &type, &arity) < 0
+            || type != ERL_BINARY_EXT
+            || arity > sizeof(msg) - 6)
+        return -1;
+
+    /* |length:2|call:2|command:2|arg:...| */
+    msglen = sizeof(msg) - 6;
+    if (alcove_decode_binary(arg, len, &index, msg+6, &msglen) < 0)
+        return -1;
+
+    put_int16(msglen + 4, msg);
+    put_int16(ALCOVE_MSG_CALL, msg+2);
+    put_int16(call, msg+4);
+
+    if (2 + npids * ALCOVE_FANOUT_ENTRY > rlen)
+        return -1;
+
+    status = alcove_arena_calloc(npids, sizeof(int));
+
+    fanout.deadline = (ap->fanout_timeout > 0)
+        ? alcove_timer_now() + ap->fanout_timeout
+        : 0;
+
+    /* Write the call to all children before waiting for any reply */
+    for (i = 0; i < npids; i++)
+        (void)pid_foreach(ap, pids[i], msg, &status[i], pid_equal,
+                alcove_fanout_send);
+
+    ALCOVE_ERR(alcove_encode_version(reply, rlen, &rindex));
+
+    for (i = 0; i < npids; i++) {
+        const char *reason = NULL;
+        size_t avail = rlen - rindex - 1
+            - (npids - i) * ALCOVE_FANOUT_ENTRY;
+
+        fanout.rv = -1;
+        fanout.reply = t;
+        fanout.rlen = sizeof(t);
+
+        switch (status[i]) {
+            case ALCOVE_FANOUT_SENT:
+                (void)pid_foreach(ap, pids[i], &fanout, NULL, pid_equal,
+                        alcove_fanout_recv);
+                if (fanout.rv < 0 && fanout.errnum == ETIMEDOUT)
+                    reason = "etimedout";
+                else
+                    reason = (fanout.rv <= 1) ? "epipe" : NULL;
+                break;
+            case ALCOVE_FANOUT_EPIPE:
+                reason = "epipe";
+                break;
+            case ALCOVE_FANOUT_ENOTSUP:
+                reason = "enotsup";
+                break;
+            default:
+                reason = "esrch";
+                break;
+        }
+
+        /* the child's reply does not fit: the call has run but the
+         * result is discarded */
+        if (reason == NULL && fanout.rv - 1 > avail)
+            reason = "e2big";
+
+        ALCOVE_ERR(alcove_encode_list_header(reply, rlen, &rindex, 1));
+        ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+        ALCOVE_ERR(alcove_encode_long(reply, rlen, &rindex, pids[i]));
+
+        if (reason != NULL) {
+            ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+            ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "error"));
+            ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, reason));
+            continue;
+        }
+
+        /* strip the version byte from the child's reply */
+        (void)memcpy(reply + rindex, t + 1, fanout.rv - 1);
+        rindex += fanout.rv - 1;
+    }
+
+    ALCOVE_ERR(alcove_encode_empty_list(reply, rlen, &rindex));
+
+    return rindex;
+}
+
+/* The reply of each child is read as a single message: calls that do
+ * not return or that send the reply in batches can't be aggregated. */
+    static int
+alcove_fanout_call(int call)
+{
+    if (call < 0 || call >= ALCOVE_NCALL)
+        return -1;
+
+    switch (call) {
+        case ALCOVE_CALL_EXECVE:
+        case ALCOVE_CALL_EXECVP:
+        case ALCOVE_CALL_EXIT:
+        case ALCOVE_CALL_FEXECVE:
+        case ALCOVE_CALL_STAT_MANY:
+        case ALCOVE_CALL_WALK:
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+    static int
+alcove_fanout_pids(const char *arg, size_t len, int *index,
+        pid_t **pids, int *npids)
+{
+    int type = 0;
+    int arity = 0;
+    int n = 0;
+
+    if (alcove_get_type(arg, len, index, &type, &arity) < 0)
+        return -1;
+
+    /* each pid is at least 1 byte */
+    if (arity < 0 || (size_t)arity > len)
+        return -1;
+
+    *npids = arity;
+
+    *pids = alcove_arena_calloc(arity, sizeof(pid_t));
+
+    switch (type) {
+        case ERL_STRING_EXT: {
+            char *tmp = NULL;
+
+            tmp = alcove_arena_alloc(arity+1);
+
+            if (alcove_decode_string(arg, len, index, tmp, arity+1) < 0)
+                return -1;
+
+            for (n = 0; n < arity; n++)
+                (*pids)[n] = (unsigned char)tmp[n];
+            }
+            break;
+
+        case ERL_LIST_EXT:
+            if ( (alcove_decode_list_header(arg, len, index, &n) < 0)
+                    || n != arity)
+                return -1;
+
+            for (n = 0; n < arity; n++) {
+                if (alcove_decode_int(arg, len, index, &(*pids)[n]) < 0
+                        || (*pids)[n] <= 0)
+                    return -1;
+            }
+
+            /* list tail */
+            if (alcove_decode_list_header(arg, len, index, &n) < 0 || n != 0)
+                return -1;
+
+            break;
+
+        case ERL_NIL_EXT:
+            if (alcove_decode_list_header(arg, len, index, &n) < 0)
+                return -1;
+            break;
+
+        default:
+            return -1;
+    }
+
+    return 0;
+}
+
+    static int
+alcove_fanout_send(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2)
+{
+    unsigned char *buf = arg1;
+    int *status = arg2;
+
+    if (c->fdctl == ALCOVE_CHILD_EXEC) {
+        *status = ALCOVE_FANOUT_ENOTSUP;
+        return 0;
+    }
+
+    /* data that does not fit in the pipe is queued */
+    *status = (c->exited || c->fdin < 0
+            || alcove_child_stdin(ap, c, (char *)buf,
+                get_int16(buf) + 2) < 0)
+        ? ALCOVE_FANOUT_EPIPE
+        : ALCOVE_FANOUT_SENT;
+
+    return 0;
+}
+
+    static int
+alcove_fanout_recv(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2)
+{
+    alcove_fanout_t *fanout = arg1;
+
+    UNUSED(arg2);
+
+    fanout->rv = alcove_child_call(ap, c, fanout->reply, fanout->rlen,
+            fanout->deadline);
+    fanout->errnum = errno;
+    return 0;
+}
@@ -23,6 +23,17 @@
     ssize_t
 alcove_sys_fork(alcove_state_t *ap, const char *arg, size_t len,
         char *reply, size_t rlen)
+{
+    UNUSED(arg);
+    UNUSED(len);
+
+    return alcove_fork(ap, NULL, reply, rlen);
+}
+
+/* Fork a child. If redirect is not NULL, the descriptors are connected
+ * to the stdio of the child when it calls exec. */
+    ssize_t
+alcove_fork(alcove_state_t *ap, const int *redirect, char *reply, size_t rlen)
 {
     int rindex = 0;
 
@@ -33,9 +44,6 @@ alcove_sys_fork(alcove_state_t *ap, const char *arg, size_t len,
     sigset_t set;
     int errnum = 0;
 
-    UNUSED(arg);
-    UNUSED(len);
-
     if (ap->depth >= ap->maxforkdepth)
         return alcove_mk_errno(reply, rlen, EAGAIN);
 
@@ -45,6 +53,9 @@ alcove_sys_fork(alcove_state_t *ap, const char *arg, size_t len,
     if (alcove_stdio(&fd) < 0)
         return alcove_mk_errno(reply, rlen, errno);
 
+    if (redirect != NULL)
+        (void)memcpy(fd.redirect, redirect, sizeof(fd.redirect));
+
     (void)sigfillset(&set);
     (void)sigemptyset(&oldset);
 
@@ -0,0 +1,168 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+#include "alcove_fork.h"
+
+static int alcove_fork_stdio_opts(alcove_state_t *ap, const char *arg,
+        size_t len, int *index, int redirect[3]);
+static int alcove_fork_stdio_target(alcove_state_t *ap, const char *arg,
+        size_t len, int *index, int *fd);
+static int child_stdin(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2);
+
+/*
+ * fork_stdio
+ *
+ * Fork a child process. The options connect the stdin, stdout or
+ * stderr of the child to a descriptor in this process when the child
+ * calls exec:
+ *
+ *  [{stdin | stdout | stderr, fd() | {stdin, pid_t()}}]
+ *
+ * {stdin, Pid} is the stdin of another child of this process. Data
+ * written to or read from redirected descriptors does not pass
+ * through the port.
+ *
+ */
+    ssize_t
+alcove_sys_fork_stdio(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int index = 0;
+    int redirect[3] = {-1, -1, -1};
+
+    /* opts */
+    switch (alcove_fork_stdio_opts(ap, arg, len, &index, redirect)) {
+        case 0:
+            break;
+        case 1:
+            return alcove_mk_errno(reply, rlen, errno);
+        default:
+            return -1;
+    }
+
+    return alcove_fork(ap, redirect, reply, rlen);
+}
+
+/* Returns 1 and sets errno if a descriptor is not valid */
+    static int
+alcove_fork_stdio_opts(alcove_state_t *ap, const char *arg, size_t len,
+        int *index, int redirect[3])
+{
+    int arity = 0;
+    int i = 0;
+
+    if (alcove_decode_list_header(arg, len, index, &arity) < 0)
+        return -1;
+
+    for (i = 0; i < arity; i++) {
+        char key[MAXATOMLEN] = {0};
+        int tarity = 0;
+        int n = 0;
+        int rv = 0;
+
+        if (alcove_decode_tuple_header(arg, len, index, &tarity) < 0 ||
+                tarity != 2)
+            return -1;
+
+        if (alcove_decode_atom(arg, len, index, key) < 0)
+            return -1;
+
+        if (strcmp(key, "stdin") == 0)
+            n = STDIN_FILENO;
+        else if (strcmp(key, "stdout") == 0)
+            n = STDOUT_FILENO;
+        else if (strcmp(key, "stderr") == 0)
+            n = STDERR_FILENO;
+        else
+            return -1;
+
+        rv = alcove_fork_stdio_target(ap, arg, len, index, &redirect[n]);
+        if (rv != 0)
+            return rv;
+    }
+
+    /* list tail */
+    if (arity > 0 && (alcove_decode_list_header(arg, len, index, &arity) < 0
+                || arity != 0))
+        return -1;
+
+    return 0;
+}
+
+    static int
+alcove_fork_stdio_target(alcove_state_t *ap, const char *arg, size_t len,
+        int *index, int *fd)
+{
+    int type = 0;
+    int arity = 0;
+    char key[MAXATOMLEN] = {0};
+    int pid = 0;
+
+    if (alcove_get_type(arg, len, index, &type, &arity) < 0)
+        return -1;
+
+    switch (type) {
+        case ERL_SMALL_INTEGER_EXT:
+        case ERL_INTEGER_EXT:
+            if (alcove_decode_int(arg, len, index, fd) < 0 || *fd < 0)
+                return -1;
+
+            if (fcntl(*fd, F_GETFD) < 0)
+                return 1;
+
+            return 0;
+
+        case ERL_SMALL_TUPLE_EXT:
+            /* {stdin, Pid} */
+            if (alcove_decode_tuple_header(arg, len, index, &arity) < 0 ||
+                    arity != 2)
+                return -1;
+
+            if (alcove_decode_atom(arg, len, index, key) < 0 ||
+                    strcmp(key, "stdin") != 0)
+                return -1;
+
+            if (alcove_decode_int(arg, len, index, &pid) < 0 || pid <= 0)
+                return -1;
+
+            *fd = -1;
+            (void)pid_foreach(ap, pid, fd, NULL, pid_equal, child_stdin);
+
+            if (*fd < 0) {
+                errno = ESRCH;
+                return 1;
+            }
+
+            return 0;
+
+        default:
+            return -1;
+    }
+}
+
+    static int
+child_stdin(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
+{
+    int *fd = arg1;
+
+    UNUSED(ap);
+    UNUSED(arg2);
+
+    *fd = c->fdin;
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+/*
+ * fstat(2)
+ *
+ */
+    ssize_t
+alcove_sys_fstat(alcove_state_t *ap, int fd, char *reply, size_t rlen)
+{
+    int rindex = 0;
+    struct stat st = {0};
+
+    UNUSED(ap);
+
+    if (fstat(fd, &st) < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    ALCOVE_OK(
+        reply,
+        rlen,
+        &rindex,
+        alcove_encode_stat(reply, rlen, &rindex, &st, ALCOVE_STAT_ALL)
+    );
+
+    return rindex;
+}
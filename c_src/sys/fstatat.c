@@ -0,0 +1,74 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+#include "alcove_at_constants.h"
+
+/*
+ * fstatat(2)
+ *
+ */
+    ssize_t
+alcove_sys_fstatat(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int index = 0;
+    int rindex = 0;
+    int dirfd = 0;
+    char pathname[PATH_MAX] = {0};
+    size_t plen = sizeof(pathname)-1;
+    int flags = 0;
+    struct stat st = {0};
+
+    UNUSED(ap);
+
+    /* dirfd: a file descriptor or at_fdcwd */
+    switch (alcove_decode_constant(arg, len, &index, &dirfd,
+                alcove_at_constants)) {
+        case 0:
+            break;
+        case 1:
+            return alcove_mk_error(reply, rlen, "enotsup");
+        default:
+            return -1;
+    }
+
+    /* pathname: may be empty with at_empty_path */
+    if (alcove_decode_iolist(arg, len, &index, pathname, &plen) < 0)
+        return -1;
+
+    /* flags */
+    switch (alcove_decode_constant_list(arg, len, &index, &flags,
+                alcove_at_constants)) {
+        case 0:
+            break;
+        case 1:
+            return alcove_mk_error(reply, rlen, "enotsup");
+        default:
+            return -1;
+    }
+
+    if (fstatat(dirfd, pathname, &st, flags) < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    ALCOVE_OK(
+        reply,
+        rlen,
+        &rindex,
+        alcove_encode_stat(reply, rlen, &rindex, &st, ALCOVE_STAT_ALL)
+    );
+
+    return rindex;
+}
@@ -0,0 +1,145 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <dirent.h>
+
+struct alcove_dirent64 {
+    u_int64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* list header + tuple header + binary header + atom + ino */
+#define ALCOVE_DIRENT_ENCODED(namelen) \
+    (5 + 2 + ALCOVE_BINARY_HDRLEN + (namelen) + 16 + 11)
+
+static const char *alcove_dirent_type(unsigned char type);
+#endif
+
+/*
+ * getdents64(2)
+ *
+ * Read a batch of entries from an open directory:
+ *
+ *  {ok, [{Name, Type, Ino}]}
+ *
+ * The file offset of the directory is the cursor: an empty list is
+ * returned at the end of the directory.
+ *
+ */
+    ssize_t
+alcove_sys_getdents(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+#ifdef __linux__
+    int index = 0;
+    int rindex = 0;
+
+    int fd = -1;
+    char *buf = NULL;
+    size_t size = 0;
+    long n = 0;
+    long pos = 0;
+    int64_t off = 0;
+
+    UNUSED(ap);
+
+    /* fd */
+    if (alcove_decode_int(arg, len, &index, &fd) < 0)
+        return -1;
+
+    ALCOVE_ERR(alcove_encode_version(reply, rlen, &rindex));
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "ok"));
+
+    /* The encoded entries are larger than the directory records: the
+     * cursor is moved back if an entry does not fit in the reply. */
+    size = (rlen - rindex) / 2;
+    buf = alcove_arena_alloc(size);
+
+    n = syscall(SYS_getdents64, fd, buf, size);
+
+    if (n < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    while (pos < n) {
+        struct alcove_dirent64 *d = (struct alcove_dirent64 *)(buf + pos);
+        size_t namelen = strlen(d->d_name);
+
+        if (rindex + ALCOVE_DIRENT_ENCODED(namelen) + 1 > rlen) {
+            if (pos == 0)
+                return alcove_mk_error(reply, rlen, "enametoolong");
+
+            /* d_off of the previous entry is the offset of this entry */
+            if (lseek(fd, off, SEEK_SET) < 0)
+                return alcove_mk_errno(reply, rlen, errno);
+
+            break;
+        }
+
+        ALCOVE_ERR(alcove_encode_list_header(reply, rlen, &rindex, 1));
+        ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 3));
+        ALCOVE_ERR(alcove_encode_binary(reply, rlen, &rindex,
+                    d->d_name, namelen));
+        ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex,
+                    alcove_dirent_type(d->d_type)));
+        ALCOVE_ERR(alcove_encode_ulonglong(reply, rlen, &rindex, d->d_ino));
+
+        off = d->d_off;
+        pos += d->d_reclen;
+    }
+
+    ALCOVE_ERR(alcove_encode_empty_list(reply, rlen, &rindex));
+
+    return rindex;
+#else
+    UNUSED(ap);
+    UNUSED(arg);
+    UNUSED(len);
+
+    return alcove_mk_atom(reply, rlen, "undef");
+#endif
+}
+
+#ifdef __linux__
+    static const char *
+alcove_dirent_type(unsigned char type)
+{
+    switch (type) {
+        case DT_BLK:
+            return "dt_blk";
+        case DT_CHR:
+            return "dt_chr";
+        case DT_DIR:
+            return "dt_dir";
+        case DT_FIFO:
+            return "dt_fifo";
+        case DT_LNK:
+            return "dt_lnk";
+        case DT_REG:
+            return "dt_reg";
+        case DT_SOCK:
+            return "dt_sock";
+        default:
+            return "dt_unknown";
+    }
+}
+#endif
@@ -49,6 +49,36 @@ alcove_sys_getopt(alcove_state_t *ap, const char *arg, size_t len,
     else if (strcmp(opt, "stderr_closed") == 0) {
         val = ap->opt & alcove_opt_stderr_closed ? 1 : 0;
     }
+    else if (strcmp(opt, "offload") == 0) {
+        val = ap->opt & alcove_opt_offload ? 1 : 0;
+    }
+    else if (strcmp(opt, "read_budget") == 0) {
+        val = ap->read_budget;
+    }
+    else if (strcmp(opt, "stdin_queue") == 0) {
+        val = ap->stdin_queue;
+    }
+    else if (strcmp(opt, "fanout_timeout") == 0) {
+        val = ap->fanout_timeout;
+    }
+    else if (strcmp(opt, "stdout_flush_bytes") == 0) {
+        val = ap->stdout_flush_bytes;
+    }
+    else if (strcmp(opt, "stdout_flush_ms") == 0) {
+        val = ap->stdout_flush_ms;
+    }
+    else if (strcmp(opt, "stdout_lines") == 0) {
+        val = ap->opt & alcove_opt_stdout_lines ? 1 : 0;
+    }
+    else if (strcmp(opt, "exit_rusage") == 0) {
+        val = ap->opt & alcove_opt_exit_rusage ? 1 : 0;
+    }
+    else if (strcmp(opt, "exit_batch") == 0) {
+        val = ap->opt & alcove_opt_exit_batch ? 1 : 0;
+    }
+    else if (strcmp(opt, "compress") == 0) {
+        val = ap->compress;
+    }
 
     return (val == -1)
         ? alcove_mk_atom(reply, rlen, "false")
@@ -19,21 +19,13 @@
  * getsid(2)
  */
     ssize_t
-alcove_sys_getsid(alcove_state_t *ap, const char *arg, size_t len,
-        char *reply, size_t rlen)
+alcove_sys_getsid(alcove_state_t *ap, pid_t pid, char *reply, size_t rlen)
 {
-    int index = 0;
     int rindex = 0;
-
-    pid_t pid = 0;
     pid_t rv = 0;
 
     UNUSED(ap);
 
-    /* pid */
-    if (alcove_decode_int(arg, len, &index, &pid) < 0)
-        return -1;
-
     rv = getsid(pid);
 
     if (rv < 0)
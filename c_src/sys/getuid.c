@@ -20,12 +20,9 @@
  *
  */
     ssize_t
-alcove_sys_getuid(alcove_state_t *ap, const char *arg, size_t len,
-        char *reply, size_t rlen)
+alcove_sys_getuid(alcove_state_t *ap, char *reply, size_t rlen)
 {
     UNUSED(ap);
-    UNUSED(arg);
-    UNUSED(len);
 
     return alcove_mk_ulong(reply, rlen, getuid());
 }
@@ -45,8 +45,6 @@ alcove_sys_pledge(alcove_state_t *ap, const char *arg, size_t len,
     rv = pledge(promises, (const char **)paths);
     errnum = errno;
 
-    alcove_free_argv(paths);
-
     return (rv < 0)
         ? alcove_mk_errno(reply, rlen, errnum)
         : alcove_mk_atom(reply, rlen, "ok");
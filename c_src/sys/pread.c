@@ -0,0 +1,51 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+/*
+ * pread(2)
+ *
+ */
+    ssize_t
+alcove_sys_pread(alcove_state_t *ap, int fd, unsigned long long count,
+        long long offset, char *reply, size_t rlen)
+{
+    int rindex = 0;
+    ssize_t rv = 0;
+
+    UNUSED(ap);
+
+    if (offset < 0)
+        return -1;
+
+    ALCOVE_ERR(alcove_encode_version(reply, rlen, &rindex));
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "ok"));
+
+    if (rindex + ALCOVE_BINARY_HDRLEN > rlen)
+        return -1;
+
+    /* Silently truncate too large values of count */
+    rv = pread(fd, reply + rindex + ALCOVE_BINARY_HDRLEN,
+            MIN(count, rlen - rindex - ALCOVE_BINARY_HDRLEN), offset);
+
+    if (rv < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    ALCOVE_ERR(alcove_encode_binary_header(reply, rlen, &rindex, rv));
+
+    return rindex;
+}
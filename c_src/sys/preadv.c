@@ -0,0 +1,207 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__OpenBSD__) \
+    || defined(__NetBSD__)
+#define HAVE_PREADV
+#endif
+
+#define ALCOVE_PREADV_MAX   1024
+
+static int alcove_preadv_counts(const char *arg, size_t len, int *index,
+        unsigned long **counts, int *ncounts);
+#ifndef HAVE_PREADV
+static ssize_t alcove_preadv(int fd, const struct iovec *iov, int iovcnt,
+        off_t offset);
+#endif
+
+/*
+ * preadv(2)
+ *
+ * Read a list of buffers. The data is read into the binaries of the
+ * reply:
+ *
+ *  {ok, [<<Count1>>, <<Count2>>, ...]}
+ *
+ * An offset of -1 reads from the current file offset.
+ *
+ */
+    ssize_t
+alcove_sys_preadv(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int index = 0;
+    int rindex = 0;
+
+    int fd = -1;
+    unsigned long *counts = NULL;
+    int ncounts = 0;
+    long long offset = 0;
+
+    struct iovec *iov = NULL;
+    size_t avail = 0;
+    size_t left = 0;
+    ssize_t rv = 0;
+    int i = 0;
+
+    UNUSED(ap);
+
+    /* fd */
+    if (alcove_decode_int(arg, len, &index, &fd) < 0)
+        return -1;
+
+    /* counts */
+    if (alcove_preadv_counts(arg, len, &index, &counts, &ncounts) < 0)
+        return -1;
+
+    /* offset */
+    if (alcove_decode_longlong(arg, len, &index, &offset) < 0
+            || offset < -1)
+        return -1;
+
+    ALCOVE_ERR(alcove_encode_version(reply, rlen, &rindex));
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "ok"));
+
+    if (ncounts == 0) {
+        ALCOVE_ERR(alcove_encode_empty_list(reply, rlen, &rindex));
+        return rindex;
+    }
+
+    ALCOVE_ERR(alcove_encode_list_header(reply, rlen, &rindex, ncounts));
+
+    /* binary headers and the list tail */
+    if (rindex + ncounts * ALCOVE_BINARY_HDRLEN + 1 > rlen)
+        return -1;
+
+    avail = rlen - rindex - ncounts * ALCOVE_BINARY_HDRLEN - 1;
+
+    /* Silently truncate too large values of count */
+    iov = alcove_arena_calloc(ncounts, sizeof(struct iovec));
+
+    for (i = 0, left = rindex; i < ncounts; i++) {
+        iov[i].iov_base = reply + left + ALCOVE_BINARY_HDRLEN;
+        iov[i].iov_len = MIN(counts[i], avail);
+        avail -= iov[i].iov_len;
+        left += ALCOVE_BINARY_HDRLEN + iov[i].iov_len;
+    }
+
+    if (offset == -1)
+        rv = readv(fd, iov, ncounts);
+    else
+#ifdef HAVE_PREADV
+        rv = preadv(fd, iov, ncounts, offset);
+#else
+        rv = alcove_preadv(fd, iov, ncounts, offset);
+#endif
+
+    if (rv < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    /* The buffers are filled in order: after a short read, the
+     * headers of the empty binaries follow the data. */
+    for (i = 0, left = rv; i < ncounts; i++) {
+        size_t n = MIN(iov[i].iov_len, left);
+        ALCOVE_ERR(alcove_encode_binary_header(reply, rlen, &rindex, n));
+        left -= n;
+    }
+
+    ALCOVE_ERR(alcove_encode_empty_list(reply, rlen, &rindex));
+
+    return rindex;
+}
+
+    static int
+alcove_preadv_counts(const char *arg, size_t len, int *index,
+        unsigned long **counts, int *ncounts)
+{
+    int type = 0;
+    int arity = 0;
+    int n = 0;
+
+    if (alcove_get_type(arg, len, index, &type, &arity) < 0)
+        return -1;
+
+    if (arity > ALCOVE_PREADV_MAX)
+        return -1;
+
+    *ncounts = arity;
+    *counts = alcove_arena_calloc(arity, sizeof(unsigned long));
+
+    switch (type) {
+        case ERL_STRING_EXT: {
+            char *tmp = alcove_arena_alloc(arity + 1);
+
+            if (alcove_decode_string(arg, len, index, tmp, arity + 1) < 0)
+                return -1;
+
+            for (n = 0; n < arity; n++)
+                (*counts)[n] = (unsigned char)tmp[n];
+            }
+            break;
+
+        case ERL_LIST_EXT:
+            if (alcove_decode_list_header(arg, len, index, &n) < 0
+                    || n != arity)
+                return -1;
+
+            for (n = 0; n < arity; n++) {
+                if (alcove_decode_ulong(arg, len, index, &(*counts)[n]) < 0)
+                    return -1;
+            }
+
+            /* list tail */
+            if (alcove_decode_list_header(arg, len, index, &n) < 0 || n != 0)
+                return -1;
+
+            break;
+
+        case ERL_NIL_EXT:
+            if (alcove_decode_list_header(arg, len, index, &n) < 0)
+                return -1;
+            break;
+
+        default:
+            return -1;
+    }
+
+    return 0;
+}
+
+#ifndef HAVE_PREADV
+    static ssize_t
+alcove_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    ssize_t total = 0;
+    ssize_t n = 0;
+    int i = 0;
+
+    for (i = 0; i < iovcnt; i++) {
+        n = pread(fd, iov[i].iov_base, iov[i].iov_len, offset + total);
+
+        if (n < 0)
+            return (total > 0) ? total : -1;
+
+        total += n;
+
+        if ((size_t)n < iov[i].iov_len)
+            break;
+    }
+
+    return total;
+}
+#endif
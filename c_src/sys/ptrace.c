@@ -56,8 +56,10 @@ alcove_sys_ptrace(alcove_state_t *ap, const char *arg, size_t len,
     pid_t pid = 0;
     alcove_ptrace_arg_t addr = {0};
     alcove_ptrace_arg_t data = {0};
-    alcove_alloc_t *elem = NULL;
-    ssize_t nelem = 0;
+    alcove_alloc_t *addr_elem = NULL;
+    ssize_t addr_nelem = 0;
+    alcove_alloc_t *data_elem = NULL;
+    ssize_t data_nelem = 0;
 
     long rv = 0;
 
@@ -95,7 +97,7 @@ alcove_sys_ptrace(alcove_state_t *ap, const char *arg, size_t len,
             addr.type = ALCOVE_PTRACEARG_CSTRUCT;
             addr.len = sizeof(addr.data);
             if (alcove_decode_cstruct(arg, len, &index, addr.data,
-                &(addr.len), &elem, &nelem) < 0)
+                &(addr.len), &addr_elem, &addr_nelem) < 0)
                 return -1;
 
             break;
@@ -131,7 +133,7 @@ alcove_sys_ptrace(alcove_state_t *ap, const char *arg, size_t len,
             data.type = ALCOVE_PTRACEARG_CSTRUCT;
             data.len = sizeof(data.data);
             if (alcove_decode_cstruct(arg, len, &index, data.data,
-                &(data.len), &elem, &nelem) < 0)
+                &(data.len), &data_elem, &data_nelem) < 0)
                 return -1;
 
             break;
@@ -164,7 +166,7 @@ alcove_sys_ptrace(alcove_state_t *ap, const char *arg, size_t len,
     switch (addr.type) {
         case ALCOVE_PTRACEARG_CSTRUCT:
             ALCOVE_ERR(alcove_encode_cstruct(reply, rlen, &rindex,
-                        addr.data, addr.len, elem, nelem));
+                        addr.data, addr.len, addr_elem, addr_nelem));
             break;
         case ALCOVE_PTRACEARG_INT: /* return an empty binary */
         case ALCOVE_PTRACEARG_BINARY:
@@ -178,7 +180,7 @@ alcove_sys_ptrace(alcove_state_t *ap, const char *arg, size_t len,
     switch (data.type) {
         case ALCOVE_PTRACEARG_CSTRUCT:
             ALCOVE_ERR(alcove_encode_cstruct(reply, rlen, &rindex,
-                        data.data, data.len, elem, nelem));
+                        data.data, data.len, data_elem, data_nelem));
             break;
         case ALCOVE_PTRACEARG_INT: /* return an empty binary */
         case ALCOVE_PTRACEARG_BINARY:
@@ -0,0 +1,86 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__OpenBSD__) \
+    || defined(__NetBSD__)
+#define HAVE_PWRITEV
+#endif
+
+#ifndef HAVE_PWRITEV
+static ssize_t alcove_pwritev(int fd, const struct iovec *iov, int iovcnt,
+        off_t offset);
+#endif
+
+/*
+ * pwritev(2)
+ *
+ * An offset of -1 writes at the current file offset.
+ *
+ */
+    ssize_t
+alcove_sys_pwritev(alcove_state_t *ap, int fd, const struct iovec *iov,
+        int iovcnt, long long offset, char *reply, size_t rlen)
+{
+    int rindex = 0;
+    ssize_t rv = 0;
+
+    UNUSED(ap);
+
+    if (offset < -1)
+        return -1;
+
+    if (offset == -1)
+        rv = writev(fd, iov, iovcnt);
+    else
+#ifdef HAVE_PWRITEV
+        rv = pwritev(fd, iov, iovcnt, offset);
+#else
+        rv = alcove_pwritev(fd, iov, iovcnt, offset);
+#endif
+
+    if (rv < 0) {
+        rindex = alcove_mk_errno(reply, rlen, errno);
+    }
+    else {
+        ALCOVE_OK(reply, rlen, &rindex,
+            alcove_encode_longlong(reply, rlen, &rindex, rv));
+    }
+
+    return rindex;
+}
+
+#ifndef HAVE_PWRITEV
+    static ssize_t
+alcove_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    char *buf = NULL;
+    size_t n = 0;
+    int i = 0;
+
+    for (i = 0; i < iovcnt; i++)
+        n += iov[i].iov_len;
+
+    buf = alcove_arena_alloc(n);
+
+    for (n = 0, i = 0; i < iovcnt; i++) {
+        (void)memcpy(buf + n, iov[i].iov_base, iov[i].iov_len);
+        n += iov[i].iov_len;
+    }
+
+    return pwrite(fd, buf, n, offset);
+}
+#endif
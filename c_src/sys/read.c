@@ -20,38 +20,64 @@
  *
  */
     ssize_t
-alcove_sys_read(alcove_state_t *ap, const char *arg, size_t len,
+alcove_sys_read(alcove_state_t *ap, int fd, unsigned long long count,
         char *reply, size_t rlen)
 {
-    int index = 0;
     int rindex = 0;
-
-    int fd = -1;
-    size_t count = 0;
-    unsigned long long val = 0;
-    char buf[MAXMSGLEN] = {0};
-    int rv = 0;
+    ssize_t rv = 0;
 
     UNUSED(ap);
 
-    /* fd */
-    if (alcove_decode_int(arg, len, &index, &fd) < 0)
-        return -1;
+    /* {ok, <<...>>}: the data is read into the binary */
+    ALCOVE_ERR(alcove_encode_version(reply, rlen, &rindex));
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "ok"));
 
-    /* count */
-    if (alcove_decode_ulonglong(arg, len, &index, &val) < 0)
+    if (rindex + ALCOVE_BINARY_HDRLEN > rlen)
         return -1;
 
-    count = val;
-
     /* Silently truncate too large values of count */
-    rv = read(fd, buf, MIN(count,rlen));
+    rv = read(fd, reply + rindex + ALCOVE_BINARY_HDRLEN,
+            MIN(count, rlen - rindex - ALCOVE_BINARY_HDRLEN));
 
     if (rv < 0)
         return alcove_mk_errno(reply, rlen, errno);
 
-    ALCOVE_OK(reply, rlen, &rindex,
-        alcove_encode_binary(reply, rlen, &rindex, buf, rv));
+    ALCOVE_ERR(alcove_encode_binary_header(reply, rlen, &rindex, rv));
 
     return rindex;
 }
+
+/*
+ * read(2): raw call
+ *
+ * The data is read directly into the reply.
+ *
+ */
+    ssize_t
+alcove_raw_read(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int32_t fd = -1;
+    u_int64_t count = 0;
+    ssize_t rv = 0;
+
+    UNUSED(ap);
+
+    /* |fd:4|count:8| */
+    if (len != sizeof(fd) + sizeof(count) || rlen < 1)
+        return -1;
+
+    (void)memcpy(&fd, arg, sizeof(fd));
+    (void)memcpy(&count, arg + sizeof(fd), sizeof(count));
+
+    /* Silently truncate too large values of count */
+    rv = read(fd, reply + 1, MIN(count, rlen - 1));
+
+    if (rv < 0)
+        return alcove_raw_errno(reply, rlen, errno);
+
+    reply[0] = ALCOVE_RAW_BINARY;
+
+    return rv + 1;
+}
@@ -52,18 +52,28 @@ alcove_sys_readdir(alcove_state_t *ap, const char *arg, size_t len,
 
     errno = 0;
     while ( (dent = readdir(dirp))) {
-        ALCOVE_ERR(alcove_encode_list_header(reply, rlen, &rindex, 1));
-        ALCOVE_ERR(alcove_encode_binary(reply, rlen, &rindex,
-                    dent->d_name, strlen(dent->d_name)));
+        /* The directory does not fit in the reply: use getdents/1 to
+         * read large directories in batches. */
+        if (alcove_encode_list_header(reply, rlen, &rindex, 1) < 0 ||
+                alcove_encode_binary(reply, rlen, &rindex,
+                    dent->d_name, strlen(dent->d_name)) < 0) {
+            (void)closedir(dirp);
+            return alcove_mk_error(reply, rlen, "e2big");
+        }
     }
 
-    if (errno != 0)
-        return alcove_mk_errno(reply, rlen, errno);
+    if (errno != 0) {
+        int errnum = errno;
+        (void)closedir(dirp);
+        return alcove_mk_errno(reply, rlen, errnum);
+    }
 
     if (closedir(dirp) < 0)
         return alcove_mk_errno(reply, rlen, errno);
 
-    ALCOVE_ERR(alcove_encode_empty_list(reply, rlen, &rindex));
+    /* [] */
+    if (alcove_encode_empty_list(reply, rlen, &rindex) < 0)
+        return alcove_mk_error(reply, rlen, "e2big");
 
     return rindex;
 }
@@ -0,0 +1,107 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+#include <fcntl.h>
+
+/*
+ * readfile
+ *
+ * Open a file, read the contents up to a maximum size and close the
+ * file. The contents are read into the reply.
+ *
+ * Returns {error, efbig} if the file is larger than the maximum size
+ * or the reply.
+ *
+ */
+    ssize_t
+alcove_sys_readfile(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int index = 0;
+    int rindex = 0;
+    char pathname[PATH_MAX] = {0};
+    size_t plen = sizeof(pathname)-1;
+    unsigned long long maxsize = 0;
+
+    int fd = -1;
+    char *buf = NULL;
+    size_t size = 0;
+    size_t total = 0;
+    ssize_t n = 0;
+    int errnum = 0;
+
+    UNUSED(ap);
+
+    /* pathname */
+    if (alcove_decode_iolist(arg, len, &index, pathname, &plen) < 0 ||
+            plen == 0)
+        return -1;
+
+    /* maxsize */
+    if (alcove_decode_ulonglong(arg, len, &index, &maxsize) < 0)
+        return -1;
+
+    ALCOVE_ERR(alcove_encode_version(reply, rlen, &rindex));
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "ok"));
+
+    if (rindex + ALCOVE_BINARY_HDRLEN > rlen)
+        return -1;
+
+    buf = reply + rindex + ALCOVE_BINARY_HDRLEN;
+    size = MIN(maxsize, rlen - rindex - ALCOVE_BINARY_HDRLEN);
+
+    fd = open(pathname, O_RDONLY|O_CLOEXEC);
+
+    if (fd < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    for ( ; ; ) {
+        char c = 0;
+
+        /* the buffer is full: check for end of file */
+        n = (total < size)
+            ? read(fd, buf + total, size - total)
+            : read(fd, &c, 1);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            errnum = errno;
+            break;
+        }
+
+        if (n == 0)
+            break;
+
+        if (total == size) {
+            errnum = EFBIG;
+            break;
+        }
+
+        total += n;
+    }
+
+    (void)close(fd);
+
+    if (errnum != 0)
+        return alcove_mk_errno(reply, rlen, errnum);
+
+    ALCOVE_ERR(alcove_encode_binary_header(reply, rlen, &rindex, total));
+
+    return rindex;
+}
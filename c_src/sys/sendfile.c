@@ -0,0 +1,49 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+/*
+ * sendfile(2)
+ *
+ * An offset of -1 uses and updates the file offset of the input file.
+ * On systems other than Linux, the data is copied with read(2) and
+ * write(2).
+ *
+ */
+    ssize_t
+alcove_sys_sendfile(alcove_state_t *ap, int outfd, int infd,
+        long long offset, unsigned long long count, char *reply, size_t rlen)
+{
+    int rindex = 0;
+    off_t off = offset;
+    ssize_t rv = 0;
+
+    UNUSED(ap);
+
+    if (offset < -1)
+        return -1;
+
+    rv = alcove_sendfile(outfd, infd, (offset == -1) ? NULL : &off,
+            MIN(count, SSIZE_MAX));
+
+    if (rv < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    ALCOVE_OK(reply, rlen, &rindex,
+        alcove_encode_longlong(reply, rlen, &rindex, rv));
+
+    return rindex;
+}
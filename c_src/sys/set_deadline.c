@@ -0,0 +1,67 @@
+/* Copyright (c) 2014, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+static int child_set_deadline(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2);
+
+/*
+ * set_deadline
+ *
+ * Send a signal to a child process when the timeout expires. The
+ * signal is sent by the event loop of this process. A timeout of 0
+ * cancels the deadline.
+ *
+ */
+    ssize_t
+alcove_sys_set_deadline(alcove_state_t *ap, int pid, unsigned long ms,
+        int signum, char *reply, size_t rlen)
+{
+    u_int64_t deadline = 0;
+
+    if (pid <= 0)
+        return alcove_mk_errno(reply, rlen, ESRCH);
+
+    if (signum < 0 || signum >= NSIG)
+        return alcove_mk_errno(reply, rlen, EINVAL);
+
+    if (ms > 0)
+        deadline = alcove_timer_now() + ms;
+
+    if (pid_foreach(ap, pid, &deadline, &signum, pid_equal,
+                child_set_deadline) != 0)
+        return alcove_mk_errno(reply, rlen, ESRCH);
+
+    return alcove_mk_atom(reply, rlen, "ok");
+}
+
+    static int
+child_set_deadline(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2)
+{
+    u_int64_t *deadline = arg1;
+    int *signum = arg2;
+
+    UNUSED(ap);
+
+    if (c->exited)
+        return 1;
+
+    c->deadline = *deadline;
+    c->deadline_sig = *signum;
+
+    return 0;
+}
@@ -50,6 +50,36 @@ alcove_sys_setopt(alcove_state_t *ap, const char *arg, size_t len,
     else if (strcmp(opt, "stderr_closed") == 0) {
         ALCOVE_SETOPT(ap, alcove_opt_stderr_closed, val);
     }
+    else if (strcmp(opt, "offload") == 0) {
+        ALCOVE_SETOPT(ap, alcove_opt_offload, val);
+    }
+    else if (strcmp(opt, "read_budget") == 0) {
+        ap->read_budget = MIN(val,INT32_MAX);
+    }
+    else if (strcmp(opt, "stdin_queue") == 0) {
+        ap->stdin_queue = MIN(val,INT32_MAX);
+    }
+    else if (strcmp(opt, "fanout_timeout") == 0) {
+        ap->fanout_timeout = MIN(val,INT32_MAX);
+    }
+    else if (strcmp(opt, "stdout_flush_bytes") == 0) {
+        ap->stdout_flush_bytes = MIN(val,INT32_MAX);
+    }
+    else if (strcmp(opt, "stdout_flush_ms") == 0) {
+        ap->stdout_flush_ms = MIN(val,INT32_MAX);
+    }
+    else if (strcmp(opt, "stdout_lines") == 0) {
+        ALCOVE_SETOPT(ap, alcove_opt_stdout_lines, val);
+    }
+    else if (strcmp(opt, "exit_rusage") == 0) {
+        ALCOVE_SETOPT(ap, alcove_opt_exit_rusage, val);
+    }
+    else if (strcmp(opt, "exit_batch") == 0) {
+        ALCOVE_SETOPT(ap, alcove_opt_exit_batch, val);
+    }
+    else if (strcmp(opt, "compress") == 0) {
+        ap->compress = MIN(val,9);
+    }
     else
         return alcove_mk_atom(reply, rlen, "false");
 
@@ -19,15 +19,12 @@
  * setsid(2)
  */
     ssize_t
-alcove_sys_setsid(alcove_state_t *ap, const char *arg, size_t len,
-        char *reply, size_t rlen)
+alcove_sys_setsid(alcove_state_t *ap, char *reply, size_t rlen)
 {
     int rindex = 0;
     pid_t pid = setsid();
 
     UNUSED(ap);
-    UNUSED(arg);
-    UNUSED(len);
 
     if (pid < 0)
         return alcove_mk_errno(reply, rlen, errno);
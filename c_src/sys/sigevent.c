@@ -0,0 +1,90 @@
+/* Copyright (c) 2014, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+#include "alcove_signal_constants.h"
+
+/*
+ * sigevent
+ *
+ * Set how signals caught by the process are reported:
+ *
+ *  every: an event for each signal (default)
+ *  coalesce: one event per event loop iteration,
+ *            {signal, Name, Info, Count}
+ *  first: the first signal only, until sigevent/2 is called again
+ *  nosiginfo: Info is an empty binary
+ *
+ */
+    ssize_t
+alcove_sys_sigevent(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int index = 0;
+    int arity = 0;
+    int signum = 0;
+    int flags = 0;
+    int i = 0;
+
+    /* signum */
+    switch (alcove_decode_constant(arg, len, &index, &signum,
+                alcove_signal_constants)) {
+        case 0:
+            break;
+        case 1:
+            return alcove_mk_error(reply, rlen, "enotsup");
+        default:
+            return -1;
+    }
+
+    /* opts */
+    if (alcove_decode_list_header(arg, len, &index, &arity) < 0)
+        return -1;
+
+    for (i = 0; i < arity; i++) {
+        char atom[MAXATOMLEN] = {0};
+
+        if (alcove_decode_atom(arg, len, &index, atom) < 0)
+            return -1;
+
+        if (strcmp(atom, "every") == 0)
+            flags &= ~(ALCOVE_SIGEVENT_COALESCE|ALCOVE_SIGEVENT_FIRST);
+        else if (strcmp(atom, "coalesce") == 0) {
+            flags &= ~ALCOVE_SIGEVENT_FIRST;
+            flags |= ALCOVE_SIGEVENT_COALESCE;
+        }
+        else if (strcmp(atom, "first") == 0) {
+            flags &= ~ALCOVE_SIGEVENT_COALESCE;
+            flags |= ALCOVE_SIGEVENT_FIRST;
+        }
+        else if (strcmp(atom, "nosiginfo") == 0)
+            flags |= ALCOVE_SIGEVENT_NOSIGINFO;
+        else
+            return -1;
+    }
+
+    /* list tail */
+    if (arity > 0 && (alcove_decode_list_header(arg, len, &index,
+                    &arity) < 0 || arity != 0))
+        return -1;
+
+    if (signum <= 0 || signum >= ALCOVE_NSIG)
+        return alcove_mk_errno(reply, rlen, EINVAL);
+
+    ap->sigevent[signum].flags = flags;
+    ap->sigevent[signum].count = 0;
+
+    return alcove_mk_atom(reply, rlen, "ok");
+}
@@ -0,0 +1,97 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+#include "alcove_splice_constants.h"
+
+/*
+ * splice(2)
+ *
+ * One of the file descriptors must be a pipe. An offset of -1 uses and
+ * updates the file offset.
+ *
+ */
+    ssize_t
+alcove_sys_splice(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+#ifdef __linux__
+    int index = 0;
+    int rindex = 0;
+    int fdin = -1;
+    long long offin = 0;
+    int fdout = -1;
+    long long offout = 0;
+    unsigned long long count = 0;
+    int flags = 0;
+    loff_t oin = 0;
+    loff_t oout = 0;
+    ssize_t rv = 0;
+
+    UNUSED(ap);
+
+    /* fd_in */
+    if (alcove_decode_int(arg, len, &index, &fdin) < 0)
+        return -1;
+
+    /* off_in */
+    if (alcove_decode_longlong(arg, len, &index, &offin) < 0 || offin < -1)
+        return -1;
+
+    /* fd_out */
+    if (alcove_decode_int(arg, len, &index, &fdout) < 0)
+        return -1;
+
+    /* off_out */
+    if (alcove_decode_longlong(arg, len, &index, &offout) < 0 || offout < -1)
+        return -1;
+
+    /* len */
+    if (alcove_decode_ulonglong(arg, len, &index, &count) < 0)
+        return -1;
+
+    /* flags */
+    switch (alcove_decode_constant_list(arg, len, &index, &flags,
+                alcove_splice_constants)) {
+        case 0:
+            break;
+        case 1:
+            return alcove_mk_error(reply, rlen, "enotsup");
+        default:
+            return -1;
+    }
+
+    oin = offin;
+    oout = offout;
+
+    rv = splice(fdin, (offin == -1) ? NULL : &oin,
+            fdout, (offout == -1) ? NULL : &oout,
+            MIN(count, SSIZE_MAX), flags);
+
+    if (rv < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    ALCOVE_OK(reply, rlen, &rindex,
+        alcove_encode_longlong(reply, rlen, &rindex, rv));
+
+    return rindex;
+#else
+    UNUSED(ap);
+    UNUSED(arg);
+    UNUSED(len);
+
+    return alcove_mk_atom(reply, rlen, "undef");
+#endif
+}
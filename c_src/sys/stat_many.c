@@ -0,0 +1,216 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+
+/* list header + #alcove_stat{} or {error, posix()} */
+#define ALCOVE_STAT_ENCODED 192
+
+typedef struct {
+    const char *name;
+    unsigned int field;
+} alcove_stat_field_t;
+
+static const alcove_stat_field_t alcove_stat_fields[] = {
+    {"atime", ALCOVE_STAT_ATIME},
+    {"blocks", ALCOVE_STAT_BLOCKS},
+    {"ctime", ALCOVE_STAT_CTIME},
+    {"gid", ALCOVE_STAT_GID},
+    {"ino", ALCOVE_STAT_INO},
+    {"mode", ALCOVE_STAT_MODE},
+    {"mtime", ALCOVE_STAT_MTIME},
+    {"nlink", ALCOVE_STAT_NLINK},
+    {"size", ALCOVE_STAT_SIZE},
+    {"type", ALCOVE_STAT_TYPE},
+    {"uid", ALCOVE_STAT_UID},
+    {NULL, 0}
+};
+
+static int alcove_stat_many_fields(const char *arg, size_t len, int *index,
+        unsigned int *mask);
+static int alcove_stat_path(const char *pathname, unsigned int *mask,
+        struct stat *st);
+
+/*
+ * stat_many
+ *
+ * Stat a list of paths:
+ *
+ *  {ok, [#alcove_stat{} | {error, posix()}]}
+ *
+ * Only the requested fields are retrieved if the system supports
+ * statx(2). If the results do not fit in a message, batches are sent
+ * as {alcove_more, [...]} before the final reply.
+ *
+ */
+    ssize_t
+alcove_sys_stat_many(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int index = 0;
+    int n = 0;
+    int i = 0;
+    char **pathname = NULL;
+    size_t plen = 0;
+    unsigned int mask = 0;
+    alcove_batch_t b = {0};
+
+    UNUSED(ap);
+
+    /* paths: decoded once into the per-call arena */
+    if (alcove_decode_list_header(arg, len, &index, &n) < 0)
+        return -1;
+
+    /* each element is at least 1 byte */
+    if (n > len)
+        return -1;
+
+    pathname = alcove_arena_alloc(n * sizeof(char *));
+
+    for (i = 0; i < n; i++) {
+        char *p = alcove_arena_reserve(PATH_MAX);
+
+        plen = PATH_MAX-1;
+        if (alcove_decode_iolist(arg, len, &index, p, &plen) < 0 ||
+                plen == 0)
+            return -1;
+
+        p[plen] = '\0';
+        pathname[i] = alcove_arena_alloc(plen + 1);
+    }
+
+    if (n > 0 && (alcove_decode_list_header(arg, len, &index, &i) < 0
+                || i != 0))
+        return -1;
+
+    /* fields */
+    if (alcove_stat_many_fields(arg, len, &index, &mask) < 0)
+        return -1;
+
+    if (alcove_batch_init(&b, reply, rlen) < 0)
+        return -1;
+
+    for (i = 0; i < n; i++) {
+        struct stat st = {0};
+        unsigned int fields = mask;
+
+        if (alcove_batch_reserve(&b, ALCOVE_STAT_ENCODED) < 0)
+            return -1;
+
+        ALCOVE_ERR(alcove_encode_list_header(b.reply, b.rlen, &b.rindex, 1));
+
+        if (alcove_stat_path(pathname[i], &fields, &st) < 0) {
+            ALCOVE_ERR(alcove_encode_tuple_header(b.reply, b.rlen,
+                        &b.rindex, 2));
+            ALCOVE_ERR(alcove_encode_atom(b.reply, b.rlen, &b.rindex,
+                        "error"));
+            ALCOVE_ERR(alcove_encode_atom(b.reply, b.rlen, &b.rindex,
+                        erl_errno_id(errno)));
+            continue;
+        }
+
+        ALCOVE_ERR(alcove_encode_stat(b.reply, b.rlen, &b.rindex,
+                    &st, fields));
+    }
+
+    return alcove_batch_reply(&b);
+}
+
+/* A list of field names: an empty list returns all fields */
+    static int
+alcove_stat_many_fields(const char *arg, size_t len, int *index,
+        unsigned int *mask)
+{
+    int n = 0;
+    int i = 0;
+    char name[MAXATOMLEN] = {0};
+    const alcove_stat_field_t *f = NULL;
+
+    if (alcove_decode_list_header(arg, len, index, &n) < 0)
+        return -1;
+
+    if (n == 0) {
+        *mask = ALCOVE_STAT_ALL;
+        return 0;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (alcove_decode_atom(arg, len, index, name) < 0)
+            return -1;
+
+        for (f = alcove_stat_fields; f->name != NULL; f++) {
+            if (strcmp(f->name, name) == 0)
+                break;
+        }
+
+        if (f->name == NULL)
+            return -1;
+
+        *mask |= f->field;
+    }
+
+    /* [] */
+    if (alcove_decode_list_header(arg, len, index, &n) < 0 || n != 0)
+        return -1;
+
+    return 0;
+}
+
+/* Fields not returned by the file system are removed from the mask */
+    static int
+alcove_stat_path(const char *pathname, unsigned int *mask, struct stat *st)
+{
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+    /* Set when the kernel returns ENOSYS, like nocopy in alcove_copy():
+     * process global, inherited by forked children and written only by
+     * the event loop (stat_many is never offloaded). */
+    static int nostatx = 0;
+    struct statx stx = {0};
+
+    if (!nostatx) {
+        if (statx(AT_FDCWD, pathname, AT_STATX_SYNC_AS_STAT,
+                    *mask, &stx) == 0) {
+            *mask &= stx.stx_mask;
+
+            st->st_mode = stx.stx_mode;
+            st->st_nlink = stx.stx_nlink;
+            st->st_uid = stx.stx_uid;
+            st->st_gid = stx.stx_gid;
+            st->st_atime = stx.stx_atime.tv_sec;
+            st->st_mtime = stx.stx_mtime.tv_sec;
+            st->st_ctime = stx.stx_ctime.tv_sec;
+            st->st_ino = stx.stx_ino;
+            st->st_size = stx.stx_size;
+            st->st_blocks = stx.stx_blocks;
+            st->st_dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+            st->st_rdev = makedev(stx.stx_rdev_major, stx.stx_rdev_minor);
+            st->st_blksize = stx.stx_blksize;
+
+            return 0;
+        }
+
+        if (errno != ENOSYS)
+            return -1;
+
+        nostatx = 1;
+    }
+#endif
+
+    return stat(pathname, st);
+}
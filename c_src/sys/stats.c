@@ -0,0 +1,312 @@
+/* Copyright (c) 2014, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+/* Maximum size of the encoded terms:
+ *  atom: ATOM_EXT header = 3 bytes
+ *  u_int64_t: SMALL_BIG_EXT = 11 bytes
+ *  pid: INTEGER_EXT = 5 bytes
+ *  tuple header = 2 bytes, list header = 5 bytes, nil = 1 byte
+ */
+#define ALCOVE_STATS_ATOM(_len) (3 + (_len))
+#define ALCOVE_STATS_COUNTER(_len) (2 + ALCOVE_STATS_ATOM(_len) + 11)
+
+/* {Pid, [{stdin, N}, {stdout, N}, {stderr, N}]} */
+#define ALCOVE_STATS_CHILD \
+    (2 + 5 + 5 + ALCOVE_STATS_COUNTER(5) + 2 * ALCOVE_STATS_COUNTER(6) + 1)
+
+/* {Pid, {error, e2big}} */
+#define ALCOVE_STATS_DESCENDANT \
+    (2 + 5 + 2 + ALCOVE_STATS_ATOM(5) + ALCOVE_STATS_ATOM(5))
+
+/* {Section, [...]} */
+#define ALCOVE_STATS_SECTION(_len) (2 + ALCOVE_STATS_ATOM(_len) + 5 + 1)
+
+typedef struct {
+    char *reply;
+    size_t rlen;
+    int *rindex;
+    int n;
+    int nencoded;
+    pid_t *pids;
+    int npids;
+} alcove_stats_reply_t;
+
+static int alcove_stats_counter(char *reply, size_t rlen, int *rindex,
+        const char *name, u_int64_t val);
+static int alcove_stats_descendants(alcove_state_t *ap,
+        alcove_stats_reply_t *s);
+static int alcove_stats_descendants_error(alcove_stats_reply_t *s,
+        const char *reason);
+static int child_count(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2);
+static int child_encode(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2);
+
+/*
+ * stats
+ *
+ * Counters maintained by the event loop of the process. The counters
+ * of forked (not exec'ed) children are retrieved by running stats in
+ * each child:
+ *
+ *  {ok, [{iterations, N}, ..., {calls, [{Call, N}]},
+ *        {children, [{Pid, [{stdin, N}, {stdout, N}, {stderr, N}]}]},
+ *        {descendants, [{Pid, {ok, Stats} | {error, posix()}}]}]}
+ *
+ */
+    ssize_t
+alcove_sys_stats(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int rindex = 0;
+    alcove_stats_reply_t s = {0};
+    int ncall = 0;
+    size_t size = 0;
+    u_int32_t i = 0;
+
+    const char *name[] = {
+        "iterations",
+        "wakeups",
+        "frames_in",
+        "bytes_in",
+        "frames_out",
+        "bytes_out",
+        "errors",
+        "eagain",
+        "refused",
+        "stdin_queue_hwm",
+        "stdout_buffer_hwm"
+    };
+    u_int64_t val[] = {
+        ap->stats.iterations,
+        ap->stats.wakeups,
+        ap->stats.frames_in,
+        ap->stats.bytes_in,
+        ap->stats.frames_out,
+        ap->stats.bytes_out,
+        ap->stats.errors,
+        ap->stats.eagain,
+        ap->stats.refused,
+        ap->stats.stdin_queue_hwm,
+        ap->stats.stdout_buffer_hwm
+    };
+
+    UNUSED(arg);
+    UNUSED(len);
+
+    s.reply = reply;
+    s.rlen = rlen;
+    s.rindex = &rindex;
+    s.pids = alcove_arena_calloc(ap->fdsetsize, sizeof(pid_t));
+
+    (void)pid_foreach(ap, 0, &s, NULL, pid_not_equal, child_count);
+
+    /* version, {ok, [...]} */
+    size = 1 + 2 + ALCOVE_STATS_ATOM(2) + 5 + 1;
+
+    for (i = 0; i < sizeof(name)/sizeof(name[0]); i++)
+        size += ALCOVE_STATS_COUNTER(strlen(name[i]));
+
+    size += ALCOVE_STATS_SECTION(5);
+
+    for (i = 0; i < ALCOVE_NCALL; i++) {
+        if (ap->ncall[i] == 0)
+            continue;
+
+        ncall++;
+        size += ALCOVE_STATS_COUNTER(strlen(alcove_call_name(i)));
+    }
+
+    size += ALCOVE_STATS_SECTION(8) + s.n * ALCOVE_STATS_CHILD;
+    size += ALCOVE_STATS_SECTION(11) + s.npids * ALCOVE_STATS_DESCENDANT;
+
+    if (size > rlen)
+        return alcove_mk_errno(reply, rlen, E2BIG);
+
+    ALCOVE_ERR(alcove_encode_version(reply, rlen, &rindex));
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "ok"));
+    ALCOVE_ERR(alcove_encode_list_header(reply, rlen, &rindex,
+                sizeof(name)/sizeof(name[0]) + 3));
+
+    for (i = 0; i < sizeof(name)/sizeof(name[0]); i++)
+        ALCOVE_ERR(alcove_stats_counter(reply, rlen, &rindex,
+                    name[i], val[i]));
+
+    /* calls */
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "calls"));
+
+    if (ncall > 0) {
+        ALCOVE_ERR(alcove_encode_list_header(reply, rlen, &rindex, ncall));
+
+        for (i = 0; i < ALCOVE_NCALL; i++) {
+            if (ap->ncall[i] == 0)
+                continue;
+
+            ALCOVE_ERR(alcove_stats_counter(reply, rlen, &rindex,
+                        alcove_call_name(i), ap->ncall[i]));
+        }
+    }
+
+    ALCOVE_ERR(alcove_encode_empty_list(reply, rlen, &rindex));
+
+    /* children */
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "children"));
+
+    if (s.n > 0) {
+        ALCOVE_ERR(alcove_encode_list_header(reply, rlen, &rindex, s.n));
+        /* the list header promises s.n elements */
+        if (pid_foreach(ap, 0, &s, NULL, pid_not_equal, child_encode) < 0 ||
+                s.nencoded != s.n)
+            return alcove_mk_errno(reply, rlen, E2BIG);
+    }
+
+    ALCOVE_ERR(alcove_encode_empty_list(reply, rlen, &rindex));
+
+    /* descendants */
+    ALCOVE_ERR(alcove_encode_tuple_header(reply, rlen, &rindex, 2));
+    ALCOVE_ERR(alcove_encode_atom(reply, rlen, &rindex, "descendants"));
+    ALCOVE_ERR(alcove_stats_descendants(ap, &s));
+
+    ALCOVE_ERR(alcove_encode_empty_list(reply, rlen, &rindex));
+
+    return rindex;
+}
+
+    static int
+alcove_stats_counter(char *reply, size_t rlen, int *rindex,
+        const char *name, u_int64_t val)
+{
+    if (alcove_encode_tuple_header(reply, rlen, rindex, 2) < 0 ||
+            alcove_encode_atom(reply, rlen, rindex, name) < 0 ||
+            alcove_encode_ulonglong(reply, rlen, rindex, val) < 0)
+        return -1;
+
+    return 0;
+}
+
+/* Run stats in the forked children using fanout */
+    static int
+alcove_stats_descendants(alcove_state_t *ap, alcove_stats_reply_t *s)
+{
+    /* stats/0: {} */
+    const char argv[] = {131, 104, 0};
+    char arg[MAXMSGLEN] = {0};
+    char t[MAXMSGLEN] = {0};
+    int index = 0;
+    ssize_t n = 0;
+    size_t avail = 0;
+    int i = 0;
+
+    if (s->npids == 0)
+        return alcove_encode_empty_list(s->reply, s->rlen, s->rindex);
+
+    ALCOVE_ERR(alcove_encode_list_header(arg, sizeof(arg), &index,
+                s->npids));
+    for (i = 0; i < s->npids; i++)
+        ALCOVE_ERR(alcove_encode_long(arg, sizeof(arg), &index, s->pids[i]));
+    ALCOVE_ERR(alcove_encode_empty_list(arg, sizeof(arg), &index));
+    ALCOVE_ERR(alcove_encode_long(arg, sizeof(arg), &index,
+                ALCOVE_CALL_STATS));
+    ALCOVE_ERR(alcove_encode_binary(arg, sizeof(arg), &index,
+                argv, sizeof(argv)));
+
+    /* leave space for the end of the reply */
+    avail = s->rlen - *s->rindex - 2;
+
+    n = alcove_sys_fanout(ap, arg, index, t, MIN(avail, sizeof(t)));
+
+    if (n < 0 || (size_t)(n - 1) > avail)
+        return alcove_stats_descendants_error(s, "e2big");
+
+    /* strip the version byte from the reply */
+    (void)memcpy(s->reply + *s->rindex, t + 1, n - 1);
+    *s->rindex += n - 1;
+
+    return 0;
+}
+
+/* The space for an error for each child is reserved by alcove_sys_stats() */
+    static int
+alcove_stats_descendants_error(alcove_stats_reply_t *s, const char *reason)
+{
+    int i = 0;
+
+    ALCOVE_ERR(alcove_encode_list_header(s->reply, s->rlen, s->rindex,
+                s->npids));
+
+    for (i = 0; i < s->npids; i++) {
+        ALCOVE_ERR(alcove_encode_tuple_header(s->reply, s->rlen,
+                    s->rindex, 2));
+        ALCOVE_ERR(alcove_encode_long(s->reply, s->rlen, s->rindex,
+                    s->pids[i]));
+        ALCOVE_ERR(alcove_encode_tuple_header(s->reply, s->rlen,
+                    s->rindex, 2));
+        ALCOVE_ERR(alcove_encode_atom(s->reply, s->rlen, s->rindex,
+                    "error"));
+        ALCOVE_ERR(alcove_encode_atom(s->reply, s->rlen, s->rindex,
+                    reason));
+    }
+
+    return alcove_encode_empty_list(s->reply, s->rlen, s->rindex);
+}
+
+    static int
+child_count(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
+{
+    alcove_stats_reply_t *s = arg1;
+
+    UNUSED(ap);
+    UNUSED(arg2);
+
+    s->n++;
+
+    if (!c->exited && c->fdctl != ALCOVE_CHILD_EXEC)
+        s->pids[s->npids++] = c->pid;
+
+    return 1;
+}
+
+    static int
+child_encode(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
+{
+    alcove_stats_reply_t *s = arg1;
+
+    UNUSED(ap);
+    UNUSED(arg2);
+
+    if (s->nencoded >= s->n)
+        return -1;
+
+    if (alcove_encode_tuple_header(s->reply, s->rlen, s->rindex, 2) < 0 ||
+            alcove_encode_long(s->reply, s->rlen, s->rindex, c->pid) < 0 ||
+            alcove_encode_list_header(s->reply, s->rlen, s->rindex, 3) < 0 ||
+            alcove_stats_counter(s->reply, s->rlen, s->rindex,
+                "stdin", c->nin) < 0 ||
+            alcove_stats_counter(s->reply, s->rlen, s->rindex,
+                "stdout", c->nout) < 0 ||
+            alcove_stats_counter(s->reply, s->rlen, s->rindex,
+                "stderr", c->nerr) < 0 ||
+            alcove_encode_empty_list(s->reply, s->rlen, s->rindex) < 0)
+        return -1;
+
+    s->nencoded++;
+
+    return 1;
+}
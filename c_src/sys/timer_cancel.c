@@ -0,0 +1,38 @@
+/* Copyright (c) 2014, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+/*
+ * timer_cancel
+ *
+ * Stop a timer started by timer_start/2.
+ *
+ */
+    ssize_t
+alcove_sys_timer_cancel(alcove_state_t *ap, u_int32_t id,
+        char *reply, size_t rlen)
+{
+    int i = 0;
+
+    for (i = 0; i < ALCOVE_MAXTIMER; i++) {
+        if (id != 0 && ap->timer[i].id == id) {
+            ap->timer[i].id = 0;
+            return alcove_mk_atom(reply, rlen, "ok");
+        }
+    }
+
+    return alcove_mk_errno(reply, rlen, ENOENT);
+}
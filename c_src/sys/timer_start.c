@@ -0,0 +1,57 @@
+/* Copyright (c) 2014, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+/*
+ * timer_start
+ *
+ * Start a timer in the event loop. When the timer expires, the process
+ * sends an event:
+ *
+ *  {timer, Id}
+ *
+ * A timer with an interval is restarted when it expires.
+ *
+ */
+    ssize_t
+alcove_sys_timer_start(alcove_state_t *ap, unsigned long ms,
+        unsigned long interval, char *reply, size_t rlen)
+{
+    int rindex = 0;
+    int i = 0;
+
+    for (i = 0; i < ALCOVE_MAXTIMER; i++) {
+        if (ap->timer[i].id == 0)
+            break;
+    }
+
+    if (i == ALCOVE_MAXTIMER)
+        return alcove_mk_errno(reply, rlen, EAGAIN);
+
+    /* 0 is not a valid id */
+    do {
+        ap->timerid++;
+    } while (ap->timerid == 0);
+
+    ap->timer[i].id = ap->timerid;
+    ap->timer[i].expires = alcove_timer_now() + ms;
+    ap->timer[i].interval = interval;
+
+    ALCOVE_OK(reply, rlen, &rindex,
+        alcove_encode_ulong(reply, rlen, &rindex, ap->timer[i].id));
+
+    return rindex;
+}
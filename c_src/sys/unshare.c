@@ -15,40 +15,28 @@
 #include "alcove.h"
 #include "alcove_call.h"
 #include "alcove_fork.h"
-#include "alcove_clone_constants.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 /*
  * unshare(2)
  *
  */
     ssize_t
-alcove_sys_unshare(alcove_state_t *ap, const char *arg, size_t len,
+alcove_sys_unshare(alcove_state_t *ap, int flags,
         char *reply, size_t rlen)
 {
 #ifdef __linux__
-    int index = 0;
-    int flags = 0;
-
     UNUSED(ap);
 
-    /* flags */
-    switch (alcove_decode_constant_list(arg, len, &index, &flags,
-                alcove_clone_constants)) {
-        case 0:
-            break;
-        case 1:
-            return alcove_mk_error(reply, rlen, "enotsup");
-        default:
-            return -1;
-    }
-
     return (unshare(flags) < 0)
         ? alcove_mk_errno(reply, rlen, errno)
         : alcove_mk_atom(reply, rlen, "ok");
 #else
     UNUSED(ap);
-    UNUSED(arg);
-    UNUSED(len);
+    UNUSED(flags);
 
     return alcove_mk_atom(reply, rlen, "undef");
 #endif
@@ -14,7 +14,6 @@
  */
 #include "alcove.h"
 #include "alcove_call.h"
-#include "alcove_wait_constants.h"
 
 #include <sys/wait.h>
 
@@ -26,42 +25,23 @@ static int remove_pid(alcove_state_t *ap, alcove_child_t *c,
  *
  */
     ssize_t
-alcove_sys_waitpid(alcove_state_t *ap, const char *arg, size_t len,
+alcove_sys_waitpid(alcove_state_t *ap, pid_t pid, int options,
         char *reply, size_t rlen)
 {
-    int index = 0;
     int rindex = 0;
-
-    pid_t pid = 0;
     int status = 0;
-    int options = 0;
 
     pid_t rv = 0;
 
-    UNUSED(ap);
-
-    /* pid */
-    if (alcove_decode_int(arg, len, &index, &pid) < 0)
-        return -1;
-
-    /* options */
-    switch (alcove_decode_constant_list(arg, len, &index, &options,
-                alcove_wait_constants)) {
-        case 0:
-            break;
-        case 1:
-            return alcove_mk_error(reply, rlen, "enotsup");
-        default:
-            return -1;
-    }
-
     rv = waitpid(pid, &status, options);
 
     if (rv < 0)
         return alcove_mk_errno(reply, rlen, errno);
 
     if (WIFEXITED(status) || WIFSIGNALED(status)) {
-        if (pid_foreach(ap, rv, NULL, NULL, pid_equal, remove_pid) < 0)
+        if (alcove_offload_self())
+            alcove_offload_exited(rv);
+        else if (alcove_waitpid_remove(ap, rv) < 0)
             return -1;
     }
 
@@ -108,6 +88,15 @@ alcove_sys_waitpid(alcove_state_t *ap, const char *arg, size_t len,
     return rindex;
 }
 
+/* Remove a child reaped by waitpid() from the table of children */
+    int
+alcove_waitpid_remove(alcove_state_t *ap, pid_t pid)
+{
+    return pid_foreach(ap, pid, NULL, NULL, pid_equal, remove_pid) < 0
+        ? -1
+        : 0;
+}
+
     static int
 remove_pid(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
 {
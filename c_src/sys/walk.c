@@ -0,0 +1,321 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+#include <sys/stat.h>
+#include <ftw.h>
+#include <fnmatch.h>
+
+/* list header + tuple header + binary header + atom + size */
+#define ALCOVE_WALK_ENCODED(pathlen) \
+    (5 + 2 + ALCOVE_BINARY_HDRLEN + (pathlen) + 16 + 11)
+
+/* file descriptors used by nftw(3) */
+#define ALCOVE_WALK_NOPENFD 16
+
+enum {
+    ALCOVE_WALK_DT_BLK = 1 << 0,
+    ALCOVE_WALK_DT_CHR = 1 << 1,
+    ALCOVE_WALK_DT_DIR = 1 << 2,
+    ALCOVE_WALK_DT_FIFO = 1 << 3,
+    ALCOVE_WALK_DT_LNK = 1 << 4,
+    ALCOVE_WALK_DT_REG = 1 << 5,
+    ALCOVE_WALK_DT_SOCK = 1 << 6,
+    ALCOVE_WALK_DT_UNKNOWN = 1 << 7
+};
+
+typedef struct {
+    const char *name;
+    int type;
+} alcove_walk_type_t;
+
+static const alcove_walk_type_t alcove_walk_types[] = {
+    {"dt_blk", ALCOVE_WALK_DT_BLK},
+    {"dt_chr", ALCOVE_WALK_DT_CHR},
+    {"dt_dir", ALCOVE_WALK_DT_DIR},
+    {"dt_fifo", ALCOVE_WALK_DT_FIFO},
+    {"dt_lnk", ALCOVE_WALK_DT_LNK},
+    {"dt_reg", ALCOVE_WALK_DT_REG},
+    {"dt_sock", ALCOVE_WALK_DT_SOCK},
+    {"dt_unknown", ALCOVE_WALK_DT_UNKNOWN},
+    {NULL, 0}
+};
+
+/* nftw(3) does not pass an argument to the callback: the state is
+ * published in a file scope variable and full batches are written to
+ * stdout from the callback. Both assume the event loop thread: walk
+ * must never be offloaded (see alcove_offload_blocking()). */
+typedef struct {
+    int maxdepth;
+    int types;
+    char match[PATH_MAX];
+    size_t matchlen;
+    char prefix[PATH_MAX];
+    size_t prefixlen;
+
+    alcove_batch_t batch;
+    int errnum;
+} alcove_walk_t;
+
+static alcove_walk_t *alcove_walk_state = NULL;
+
+static int alcove_walk_opts(const char *arg, size_t len, int *index,
+        alcove_walk_t *w);
+static int alcove_walk_entry(const char *path, const struct stat *st,
+        int flag, struct FTW *ftw);
+static int alcove_walk_type(int flag, const struct stat *st);
+
+#ifdef FTW_ACTIONRETVAL
+#define ALCOVE_WALK_CONTINUE        FTW_CONTINUE
+#define ALCOVE_WALK_SKIP_SUBTREE    FTW_SKIP_SUBTREE
+#define ALCOVE_WALK_STOP            FTW_STOP
+#define ALCOVE_WALK_FLAGS           (FTW_PHYS|FTW_ACTIONRETVAL)
+#else
+#define ALCOVE_WALK_CONTINUE        0
+#define ALCOVE_WALK_SKIP_SUBTREE    0
+#define ALCOVE_WALK_STOP            1
+#define ALCOVE_WALK_FLAGS           FTW_PHYS
+#endif
+
+/*
+ * walk
+ *
+ * Traverse a directory tree:
+ *
+ *  {ok, [{Path, Type, Size}]}
+ *
+ * Entries are filtered by depth, type and name. If the entries do not
+ * fit in a message, batches are sent as {alcove_more, [...]} before
+ * the final reply.
+ *
+ */
+    ssize_t
+alcove_sys_walk(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int index = 0;
+
+    char root[PATH_MAX] = {0};
+    size_t rootlen = sizeof(root)-1;
+    alcove_walk_t *w = NULL;
+    int rv = 0;
+
+    UNUSED(ap);
+
+    /* root */
+    if (alcove_decode_iolist(arg, len, &index, root, &rootlen) < 0 ||
+            rootlen == 0)
+        return -1;
+
+    /* published through alcove_walk_state: walk is never offloaded */
+    w = alcove_arena_calloc(1, sizeof(alcove_walk_t));
+    w->maxdepth = -1;
+    w->types = ~0;
+
+    /* options */
+    if (alcove_walk_opts(arg, len, &index, w) < 0)
+        return -1;
+
+    if (alcove_batch_init(&w->batch, reply, rlen) < 0)
+        return -1;
+
+    alcove_walk_state = w;
+    rv = nftw(root, alcove_walk_entry, ALCOVE_WALK_NOPENFD,
+            ALCOVE_WALK_FLAGS);
+    alcove_walk_state = NULL;
+
+    if (w->errnum != 0)
+        return alcove_mk_errno(reply, rlen, w->errnum);
+
+    if (rv == -1)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    return alcove_batch_reply(&w->batch);
+}
+
+    static int
+alcove_walk_opts(const char *arg, size_t len, int *index, alcove_walk_t *w)
+{
+    int arity = 0;
+    int i = 0;
+
+    if (alcove_decode_list_header(arg, len, index, &arity) < 0)
+        return -1;
+
+    for (i = 0; i < arity; i++) {
+        char key[MAXATOMLEN] = {0};
+        int tarity = 0;
+
+        if (alcove_decode_tuple_header(arg, len, index, &tarity) < 0 ||
+                tarity != 2)
+            return -1;
+
+        if (alcove_decode_atom(arg, len, index, key) < 0)
+            return -1;
+
+        if (strcmp(key, "maxdepth") == 0) {
+            if (alcove_decode_int(arg, len, index, &w->maxdepth) < 0 ||
+                    w->maxdepth < 0)
+                return -1;
+        }
+        else if (strcmp(key, "type") == 0) {
+            int n = 0;
+            int j = 0;
+
+            if (alcove_decode_list_header(arg, len, index, &n) < 0)
+                return -1;
+
+            w->types = 0;
+
+            for (j = 0; j < n; j++) {
+                char type[MAXATOMLEN] = {0};
+                const alcove_walk_type_t *t = NULL;
+
+                if (alcove_decode_atom(arg, len, index, type) < 0)
+                    return -1;
+
+                for (t = alcove_walk_types; t->name != NULL; t++) {
+                    if (strcmp(type, t->name) == 0)
+                        break;
+                }
+
+                if (t->name == NULL)
+                    return -1;
+
+                w->types |= t->type;
+            }
+
+            if (n > 0 && (alcove_decode_list_header(arg, len, index, &n) < 0
+                        || n != 0))
+                return -1;
+        }
+        else if (strcmp(key, "match") == 0) {
+            w->matchlen = sizeof(w->match)-1;
+            if (alcove_decode_iolist(arg, len, index, w->match,
+                        &w->matchlen) < 0)
+                return -1;
+        }
+        else if (strcmp(key, "prefix") == 0) {
+            w->prefixlen = sizeof(w->prefix)-1;
+            if (alcove_decode_iolist(arg, len, index, w->prefix,
+                        &w->prefixlen) < 0)
+                return -1;
+        }
+        else {
+            return -1;
+        }
+    }
+
+    /* list tail */
+    if (arity > 0 && (alcove_decode_list_header(arg, len, index, &arity) < 0
+                || arity != 0))
+        return -1;
+
+    return 0;
+}
+
+    static int
+alcove_walk_entry(const char *path, const struct stat *st, int flag,
+        struct FTW *ftw)
+{
+    alcove_walk_t *w = alcove_walk_state;
+    alcove_batch_t *b = &w->batch;
+    const char *name = path + ftw->base;
+    size_t pathlen = strlen(path);
+    int type = 0;
+    const alcove_walk_type_t *t = NULL;
+
+    /* nftw(3) without FTW_ACTIONRETVAL: subtrees are not pruned */
+    if (w->maxdepth >= 0 && ftw->level > w->maxdepth)
+        return ALCOVE_WALK_CONTINUE;
+
+    type = alcove_walk_type(flag, st);
+
+    /* The root could not be read */
+    if (ftw->level == 0 && flag == FTW_NS) {
+        w->errnum = errno;
+        return ALCOVE_WALK_STOP;
+    }
+
+    if (!(w->types & type))
+        goto NEXT;
+
+    if (w->prefixlen > 0 && strncmp(name, w->prefix, w->prefixlen) != 0)
+        goto NEXT;
+
+    if (w->matchlen > 0 && fnmatch(w->match, name, 0) != 0)
+        goto NEXT;
+
+    if (alcove_batch_reserve(b, ALCOVE_WALK_ENCODED(pathlen)) < 0) {
+        w->errnum = ENAMETOOLONG;
+        return ALCOVE_WALK_STOP;
+    }
+
+    for (t = alcove_walk_types; t->name != NULL; t++) {
+        if (t->type == type)
+            break;
+    }
+
+    /* The callback must return an action: an encoding error stops the
+     * walk and is returned as an errno */
+    if (alcove_encode_list_header(b->reply, b->rlen, &b->rindex, 1) < 0 ||
+            alcove_encode_tuple_header(b->reply, b->rlen, &b->rindex, 3) < 0 ||
+            alcove_encode_binary(b->reply, b->rlen, &b->rindex,
+                path, pathlen) < 0 ||
+            alcove_encode_atom(b->reply, b->rlen, &b->rindex, t->name) < 0 ||
+            alcove_encode_ulonglong(b->reply, b->rlen, &b->rindex,
+                (flag == FTW_NS) ? 0 : st->st_size) < 0) {
+        w->errnum = E2BIG;
+        return ALCOVE_WALK_STOP;
+    }
+
+NEXT:
+    if (flag == FTW_D && w->maxdepth >= 0 && ftw->level == w->maxdepth)
+        return ALCOVE_WALK_SKIP_SUBTREE;
+
+    return ALCOVE_WALK_CONTINUE;
+}
+
+    static int
+alcove_walk_type(int flag, const struct stat *st)
+{
+    switch (flag) {
+        case FTW_NS:
+            return ALCOVE_WALK_DT_UNKNOWN;
+        case FTW_SL:
+        case FTW_SLN:
+            return ALCOVE_WALK_DT_LNK;
+        default:
+            break;
+    }
+
+    if (S_ISREG(st->st_mode))
+        return ALCOVE_WALK_DT_REG;
+    if (S_ISDIR(st->st_mode))
+        return ALCOVE_WALK_DT_DIR;
+    if (S_ISLNK(st->st_mode))
+        return ALCOVE_WALK_DT_LNK;
+    if (S_ISCHR(st->st_mode))
+        return ALCOVE_WALK_DT_CHR;
+    if (S_ISBLK(st->st_mode))
+        return ALCOVE_WALK_DT_BLK;
+    if (S_ISFIFO(st->st_mode))
+        return ALCOVE_WALK_DT_FIFO;
+    if (S_ISSOCK(st->st_mode))
+        return ALCOVE_WALK_DT_SOCK;
+
+    return ALCOVE_WALK_DT_UNKNOWN;
+}
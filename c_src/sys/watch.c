@@ -0,0 +1,118 @@
+/* Copyright (c) 2014, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+
+static int alcove_watch_flags(const char *arg, size_t len, int *index,
+        int *flags);
+static int child_fd(alcove_state_t *ap, alcove_child_t *c,
+        void *arg1, void *arg2);
+
+/*
+ * watch
+ *
+ * Add a descriptor to the event loop. An event is sent when the
+ * descriptor is ready:
+ *
+ *  {fd_ready, FD, [read | write | hup | err | nval]}
+ *
+ * Events: [read | write | hup]
+ * Options: [oneshot | persistent], defaults to oneshot
+ *
+ */
+    ssize_t
+alcove_sys_watch(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int index = 0;
+    int fd = -1;
+    int flags = ALCOVE_WATCH_ONESHOT;
+
+    /* fd */
+    if (alcove_decode_int(arg, len, &index, &fd) < 0)
+        return -1;
+
+    /* events, options */
+    if (alcove_watch_flags(arg, len, &index, &flags) < 0)
+        return -1;
+
+    if (fd < 0 || fd >= ap->maxfd || fcntl(fd, F_GETFD) < 0)
+        return alcove_mk_errno(reply, rlen, EBADF);
+
+    /* descriptors used by the event loop */
+    if (fd < ALCOVE_MAXFILENO || alcove_offload_pipe(fd)
+            || pid_foreach(ap, 0, &fd, NULL, pid_not_equal, child_fd) == 0)
+        return alcove_mk_errno(reply, rlen, EBUSY);
+
+    ap->watch[fd] = flags;
+
+    return alcove_mk_atom(reply, rlen, "ok");
+}
+
+    static int
+alcove_watch_flags(const char *arg, size_t len, int *index, int *flags)
+{
+    int arity = 0;
+    int i = 0;
+    int n = 0;
+
+    for (n = 0; n < 2; n++) {
+        if (alcove_decode_list_header(arg, len, index, &arity) < 0)
+            return -1;
+
+        for (i = 0; i < arity; i++) {
+            char atom[MAXATOMLEN] = {0};
+
+            if (alcove_decode_atom(arg, len, index, atom) < 0)
+                return -1;
+
+            if (n == 0 && strcmp(atom, "read") == 0)
+                *flags |= ALCOVE_WATCH_READ;
+            else if (n == 0 && strcmp(atom, "write") == 0)
+                *flags |= ALCOVE_WATCH_WRITE;
+            else if (n == 0 && strcmp(atom, "hup") == 0)
+                *flags |= ALCOVE_WATCH_HUP;
+            else if (n == 1 && strcmp(atom, "oneshot") == 0)
+                *flags |= ALCOVE_WATCH_ONESHOT;
+            else if (n == 1 && strcmp(atom, "persistent") == 0)
+                *flags &= ~ALCOVE_WATCH_ONESHOT;
+            else
+                return -1;
+        }
+
+        /* list tail */
+        if (arity > 0 && (alcove_decode_list_header(arg, len, index,
+                        &arity) < 0 || arity != 0))
+            return -1;
+    }
+
+    return 0;
+}
+
+    static int
+child_fd(alcove_state_t *ap, alcove_child_t *c, void *arg1, void *arg2)
+{
+    int *fd = arg1;
+
+    UNUSED(ap);
+    UNUSED(arg2);
+
+    if (*fd == c->fdctl || *fd == c->fdin || *fd == c->fdout
+            || *fd == c->fderr
+            || (c->bridge != NULL && *fd == c->bridge->fd))
+        return 0;
+
+    return 1;
+}
@@ -20,28 +20,16 @@
  *
  */
     ssize_t
-alcove_sys_write(alcove_state_t *ap, const char *arg, size_t len,
-        char *reply, size_t rlen)
+alcove_sys_write(alcove_state_t *ap, int fd, const struct iovec *iov,
+        int iovcnt, char *reply, size_t rlen)
 {
-    int index = 0;
     int rindex = 0;
-
-    int fd = -1;
-    char buf[MAXMSGLEN] = {0};
-    size_t buflen = sizeof(buf);
-    int rv = 0;
+    ssize_t rv = 0;
 
     UNUSED(ap);
 
-    /* fd */
-    if (alcove_decode_int(arg, len, &index, &fd) < 0)
-        return -1;
-
-    /* buf */
-    if (alcove_decode_iolist(arg, len, &index, buf, &buflen) < 0)
-        return -1;
-
-    rv = write(fd, buf, buflen);
+    /* the data is written from the message buffer */
+    rv = writev(fd, iov, iovcnt);
 
     if (rv < 0) {
         rindex = alcove_mk_errno(reply, rlen, errno);
@@ -53,3 +41,29 @@ alcove_sys_write(alcove_state_t *ap, const char *arg, size_t len,
 
     return rindex;
 }
+
+/*
+ * write(2): raw call
+ *
+ */
+    ssize_t
+alcove_raw_write(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int32_t fd = -1;
+    ssize_t rv = 0;
+
+    UNUSED(ap);
+
+    /* |fd:4|data:...| */
+    if (len < sizeof(fd))
+        return -1;
+
+    (void)memcpy(&fd, arg, sizeof(fd));
+
+    rv = write(fd, arg + sizeof(fd), len - sizeof(fd));
+
+    return (rv < 0)
+        ? alcove_raw_errno(reply, rlen, errno)
+        : alcove_raw_int64(reply, rlen, rv);
+}
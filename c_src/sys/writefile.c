@@ -0,0 +1,111 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+#include "alcove_call.h"
+#include "alcove_file_constants.h"
+
+#include <fcntl.h>
+
+/*
+ * writefile
+ *
+ * Open a file, write the data and close the file. The file is opened
+ * for writing if the flags do not include an access mode. Files are
+ * created with mode 0666, modified by the process umask.
+ *
+ */
+    ssize_t
+alcove_sys_writefile(alcove_state_t *ap, const char *arg, size_t len,
+        char *reply, size_t rlen)
+{
+    int index = 0;
+    int rindex = 0;
+    char pathname[PATH_MAX] = {0};
+    size_t plen = sizeof(pathname)-1;
+    struct iovec *iov = NULL;
+    int iovcnt = 0;
+    int flags = 0;
+
+    int fd = -1;
+    long long total = 0;
+    ssize_t n = 0;
+    int errnum = 0;
+
+    UNUSED(ap);
+
+    /* pathname */
+    if (alcove_decode_iolist(arg, len, &index, pathname, &plen) < 0 ||
+            plen == 0)
+        return -1;
+
+    /* data: written from the message buffer */
+    if (alcove_decode_iovec(arg, len, &index, &iov, &iovcnt) < 0)
+        return -1;
+
+    /* flags */
+    switch (alcove_decode_constant_list(arg, len, &index, &flags,
+                alcove_file_constants)) {
+        case 0:
+            break;
+        case 1:
+            return alcove_mk_error(reply, rlen, "enotsup");
+        default:
+            return -1;
+    }
+
+    if ((flags & O_ACCMODE) == O_RDONLY)
+        flags |= O_WRONLY;
+
+    fd = open(pathname, flags|O_CLOEXEC, 0666);
+
+    if (fd < 0)
+        return alcove_mk_errno(reply, rlen, errno);
+
+    while (iovcnt > 0) {
+        n = writev(fd, iov, iovcnt);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            errnum = errno;
+            break;
+        }
+
+        if (n == 0)
+            break;
+
+        total += n;
+
+        /* partial write: skip the data written */
+        for ( ; iovcnt > 0 && (size_t)n >= iov->iov_len; iov++, iovcnt--)
+            n -= iov->iov_len;
+
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+
+    if (close(fd) < 0 && errnum == 0)
+        errnum = errno;
+
+    if (errnum != 0)
+        return alcove_mk_errno(reply, rlen, errnum);
+
+    ALCOVE_OK(reply, rlen, &rindex,
+        alcove_encode_longlong(reply, rlen, &rindex, total));
+
+    return rindex;
+}
@@ -17,6 +17,8 @@
 static char *alcove_x_decode_iolist_to_string(const char *buf, size_t len,
         int *index);
 
+/* The argument vector is allocated from the per-call arena and is
+ * released when the call returns. */
     int
 alcove_decode_argv(const char *arg, size_t len, int *index,
         char ***argv)
@@ -39,59 +41,40 @@ alcove_decode_argv(const char *arg, size_t len, int *index,
         return -1;
 
     /* NULL terminate */
-    *argv = calloc(arity + 1, sizeof(char *));
-
-    if (*argv == NULL)
-        exit(errno);
+    *argv = alcove_arena_calloc(arity + 1, sizeof(char *));
 
     for (i = 0; i < arity; i++) {
         (*argv)[i] = alcove_x_decode_iolist_to_string(arg, len, index);
         if (!(*argv)[i])
-            goto BADARG;
+            return -1;
     }
 
     /* list tail */
     if (arity > 0 && (alcove_decode_list_header(arg, len, index, &empty) < 0
                 || empty != 0))
-        goto BADARG;
+        return -1;
 
     return 0;
-
-BADARG:
-    alcove_free_argv(*argv);
-    return -1;
 }
 
     static char *
 alcove_x_decode_iolist_to_string(const char *buf, size_t len, int *index)
 {
-    char tmp[MAXMSGLEN] = {0};
-    size_t tmplen = sizeof(tmp) - 1;
     char *res = NULL;
+    size_t reslen = 0;
 
-    if (alcove_decode_iolist(buf, len, index, tmp, &tmplen) < 0)
+    if (*index < 0 || (size_t)*index >= len)
         return NULL;
 
-    res = strdup(tmp);
-    if (res == NULL)
-        exit(errno);
-
-    return res;
-}
-
-    void
-alcove_free_argv(char **argv)
-{
-    int i = 0;
+    /* the decoded iolist is never larger than the encoded term: decode
+     * in place into the arena */
+    reslen = len - *index;
+    res = alcove_arena_reserve(reslen + 1);
 
-    if (argv == NULL)
-        return;
+    if (alcove_decode_iolist(buf, len, index, res, &reslen) < 0)
+        return NULL;
 
-    for (i = 0; argv[i]; i++) {
-        free(argv[i]);
-        argv[i] = NULL;
-    }
+    res[reslen] = '\0';
 
-    free(argv);
-    argv = NULL;
+    return alcove_arena_alloc(reslen + 1);
 }
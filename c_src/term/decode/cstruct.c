@@ -14,21 +14,42 @@
  */
 #include "alcove.h"
 
+static int alcove_decode_cstruct_internal(const char *arg, size_t len,
+        int *index, char *res, size_t *rlen, alcove_alloc_t **ptr,
+        ssize_t *nptr, int persist);
 static void *alcove_malloc(ssize_t);
 
+/* The element array and the targets of {ptr, ...} are allocated from
+ * the per-call arena and are released when the call returns. */
     int
 alcove_decode_cstruct(const char *arg, size_t len, int *index,
         char *res, size_t *rlen, alcove_alloc_t **ptr, ssize_t *nptr)
+{
+    return alcove_decode_cstruct_internal(arg, len, index, res, rlen,
+            ptr, nptr, 0);
+}
+
+/* The targets of {ptr, ...} outlive the call and are never freed. */
+    int
+alcove_decode_cstruct_persist(const char *arg, size_t len, int *index,
+        char *res, size_t *rlen, alcove_alloc_t **ptr, ssize_t *nptr)
+{
+    return alcove_decode_cstruct_internal(arg, len, index, res, rlen,
+            ptr, nptr, 1);
+}
+
+    static int
+alcove_decode_cstruct_internal(const char *arg, size_t len, int *index,
+        char *res, size_t *rlen, alcove_alloc_t **ptr, ssize_t *nptr,
+        int persist)
 {
     int type = 0;
     int arity = 0;
-    size_t tmp_size = 0;
-    long size = 0;
+    size_t size = 0;
 
-    int tmp_index = 0;
     int tmp_arity = 0;
 
-    char tmp[MAXMSGLEN] = {0};
+    char tmp[MAXATOMLEN] = {0};
     unsigned long val = 0;
 
     int i = 0;
@@ -52,151 +73,132 @@ alcove_decode_cstruct(const char *arg, size_t len, int *index,
     if (arity == 0 || arity > 1023)
         return -1;
 
-    tmp_index = *index;
-    tmp_arity = arity;
+    *ptr = alcove_arena_calloc(arity, sizeof(alcove_alloc_t));
 
-    /* Calculate the size required */
+    /* Decode the list in one pass:
+     *
+     * n = number of bytes written to the buffer
+     * total = number of bytes to be allocated
+     *
+     * total may be smaller than n, e.g., pointer to 1 byte
+     */
     for (i = 0; i < arity; i++) {
-        if (alcove_get_type(arg, len, &tmp_index, &type, &tmp_arity) < 0)
-            return -1;
+        char *p = NULL;
+
+        if (alcove_get_type(arg, len, index, &type, &tmp_arity) < 0)
+            goto ERR;
 
         switch (type) {
             case ERL_BINARY_EXT:
-                if (tmp_arity > sizeof(tmp))
-                    return -1;
-
-                if (alcove_decode_binary(arg, len, &tmp_index, tmp, &tmp_size) < 0)
-                    return -1;
+                if (tmp_arity > *rlen - n || tmp_arity > *rlen - total)
+                    goto ERR;
 
-                if (tmp_size > INT32_MAX)
-                    return -1;
+                if (alcove_decode_binary(arg, len, index, res + n, &size) < 0)
+                    goto ERR;
 
-                n += tmp_size;
-                total += tmp_size;
+                n += size;
+                total += size;
+                (*ptr)[i].p = NULL;
+                (*ptr)[i].len = size;
                 break;
 
             case ERL_SMALL_TUPLE_EXT:
                 if (tmp_arity != 2)
-                    return -1;
+                    goto ERR;
 
-                if (alcove_decode_tuple_header(arg, len, &tmp_index, &tmp_arity) < 0)
-                    return -1;
+                if (alcove_decode_tuple_header(arg, len, index, &tmp_arity) < 0)
+                    goto ERR;
 
-                if (alcove_decode_atom(arg, len, &tmp_index, tmp) < 0)
-                    return -1;
+                if (alcove_decode_atom(arg, len, index, tmp) < 0)
+                    goto ERR;
 
                 if (strcmp(tmp, "ptr") != 0)
-                    return -1;
+                    goto ERR;
 
-                if (alcove_get_type(arg, len, &tmp_index, &type, &tmp_arity) < 0)
-                    return -1;
+                if (sizeof(void *) > *rlen - n)
+                    goto ERR;
+
+                if (alcove_get_type(arg, len, index, &type, &tmp_arity) < 0)
+                    goto ERR;
 
                 switch (type) {
                     case ERL_SMALL_INTEGER_EXT:
                     case ERL_INTEGER_EXT:
-                        if (alcove_decode_ulong(arg, len, &tmp_index, &val) < 0)
-                            return -1;
+                        if (alcove_decode_ulong(arg, len, index, &val) < 0)
+                            goto ERR;
+
+                        if (val > *rlen - total)
+                            goto ERR;
+
+                        if (val > 0) {
+                            p = persist
+                                ? calloc(val, 1)
+                                : alcove_arena_calloc(val, 1);
+                            if (p == NULL)
+                                exit(errno);
+                            (*ptr)[i].len = val;
+                        }
+                        else {
+                            /* NULL pointer: return a binary */
+                            (*ptr)[i].len = sizeof(void *);
+                        }
 
-                        n += sizeof(void *);
                         total += val;
                         break;
 
                     case ERL_BINARY_EXT:
-                        if (alcove_decode_binary(arg, len, &tmp_index, tmp, &tmp_size) < 0)
-                            return -1;
-
-                        if (tmp_size > INT32_MAX)
-                            return -1;
+                        if (tmp_arity > *rlen - total)
+                            goto ERR;
+
+                        if (tmp_arity > 0) {
+                            p = persist
+                                ? alcove_malloc(tmp_arity)
+                                : alcove_arena_alloc(tmp_arity);
+                            /* set before decoding: freed on error */
+                            (*ptr)[i].p = p;
+                            if (alcove_decode_binary(arg, len, index, p,
+                                        &size) < 0)
+                                goto ERR;
+                            (*ptr)[i].len = size;
+                        }
+                        else {
+                            if (alcove_decode_binary(arg, len, index, tmp,
+                                        &size) < 0)
+                                goto ERR;
+                            /* NULL pointer: return a binary */
+                            (*ptr)[i].len = sizeof(void *);
+                        }
 
-                        n += sizeof(void *);
-                        total += tmp_size;
+                        total += tmp_arity;
                         break;
 
                     default:
-                        return -1;
+                        goto ERR;
                 }
+
+                (void)memcpy(res + n, &p, sizeof(void *));
+                n += sizeof(void *);
+                (*ptr)[i].p = p;
                 break;
 
             default:
-                return -1;
+                goto ERR;
         }
     }
 
-    /* n = number of bytes written to the buffer
-     * total = number of bytes to be allocated
-     *
-     * total may be smaller than n, e.g., pointer to 1 byte
-     */
-    if (n > *rlen || total > *rlen)
-        return -1;
-
     *rlen = n;
-
-    *ptr = alcove_malloc(arity * sizeof(alcove_alloc_t));
     *nptr = arity;
 
-    /* Copy the list contents */
-    for (i = 0; i < arity; i++) {
-        (void)ei_get_type(arg, index, &type, &tmp_arity);
-
-        switch (type) {
-            case ERL_BINARY_EXT:
-                (void)ei_decode_binary(arg, index, res, &size);
-                res += size;
-                (*ptr)[i].p = NULL;
-                (*ptr)[i].len = size;
-                break;
-
-            case ERL_SMALL_TUPLE_EXT:
-                (void)ei_decode_tuple_header(arg, index, &tmp_arity);
-                (void)ei_decode_atom(arg, index, tmp);
-                (void)ei_get_type(arg, index, &type, &tmp_arity);
-
-                switch (type) {
-                    case ERL_SMALL_INTEGER_EXT:
-                    case ERL_INTEGER_EXT: {
-                        char *p = NULL;
-
-                        (void)ei_decode_ulong(arg, index, &val);
-
-                        if (val > 0) {
-                        p = calloc(val, 1);
-                        if (p == NULL)
-                            exit(errno);
-                        (*ptr)[i].len = val;
-                        }
-                        else {
-                        /* NULL pointer: return a binary */
-                        (*ptr)[i].len = sizeof(void *);
-                        }
-                        (void)memcpy(res, &p, sizeof(void *));
-                        res += sizeof(void *);
-                        (*ptr)[i].p = p;
-                        }
-                        break;
+    return 0;
 
-                    case ERL_BINARY_EXT: {
-                        char *p = NULL;
-                        (void)ei_decode_binary(arg, index, tmp, &size);
-                        if (size > 0) {
-                        p = alcove_malloc(size);
-                        (void)memcpy(p, tmp, size);
-                        (*ptr)[i].len = size;
-                        }
-                        else {
-                        /* NULL pointer: return a binary */
-                        (*ptr)[i].len = sizeof(void *);
-                        }
-                        (void)memcpy(res, &p, sizeof(void *));
-                        res += sizeof(void *);
-                        (*ptr)[i].p = p;
-                        }
-                        break;
-                }
-        }
+ERR:
+    /* release the {ptr, ...} targets allocated outside of the arena */
+    if (persist) {
+        for ( ; i >= 0; i--)
+            free((*ptr)[i].p);
     }
 
-    return 0;
+    return -1;
 }
 
     static void *
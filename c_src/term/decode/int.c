@@ -17,8 +17,30 @@
     int
 alcove_decode_int(const char *buf, size_t len, int *index, int *n)
 {
+    const char *s = buf + *index;
     long val = 0;
 
+    /* fixed size integers: decode in place */
+    if (*index >= 0 && *index + 1 < len) {
+        switch (get_int8(s)) {
+            case ERL_SMALL_INTEGER_EXT:
+                *n = get_int8(s+1);
+                *index += 2;
+                return 0;
+
+            case ERL_INTEGER_EXT:
+                if (*index + 5 > len)
+                    return -1;
+
+                *n = (int32_t)get_int32(s+1);
+                *index += 5;
+                return 0;
+
+            default:
+                break;
+        }
+    }
+
     if (alcove_decode_long(buf, len, index, &val) < 0 || val < INT32_MIN
             || val > INT32_MAX)
         return -1;
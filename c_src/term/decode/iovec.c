@@ -0,0 +1,195 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+
+#define ALCOVE_IOV_MAX  MIN(IOV_MAX, 1024)
+
+typedef struct {
+    struct iovec *iov;
+    int iovcnt;
+    /* bytes that are not contiguous in the message */
+    char *copy;
+    size_t copylen;
+    size_t copysize;
+} alcove_iovec_t;
+
+static int alcove_decode_iovec_internal(const char *buf, size_t len,
+        int *index, alcove_iovec_t *v, int depth);
+static void alcove_iovec_append(alcove_iovec_t *v, const char *p, size_t n,
+        int inplace);
+
+/*
+ * Decode an iolist to an array of iovecs. Binaries and strings reference
+ * the message buffer: the data is not copied. Bytes in lists are copied
+ * to a buffer allocated from the per-call arena.
+ *
+ * The iovec array is allocated from the per-call arena.
+ */
+    int
+alcove_decode_iovec(const char *buf, size_t len, int *index,
+        struct iovec **iov, int *iovcnt)
+{
+    int type = 0;
+    int arity = 0;
+    alcove_iovec_t v = {0};
+
+    if (alcove_get_type(buf, len, index, &type, &arity) < 0)
+        return -1;
+
+    switch (type) {
+        case ERL_BINARY_EXT:
+        case ERL_LIST_EXT:
+        case ERL_NIL_EXT:
+        case ERL_STRING_EXT:
+            break;
+
+        default:
+            return -1;
+    }
+
+    v.iov = alcove_arena_calloc(ALCOVE_IOV_MAX, sizeof(struct iovec));
+    /* the decoded iolist is never larger than the encoded term */
+    v.copysize = len - *index;
+
+    if (alcove_decode_iovec_internal(buf, len, index, &v, 0) < 0)
+        return -1;
+
+    *iov = v.iov;
+    *iovcnt = v.iovcnt;
+
+    return 0;
+}
+
+    static int
+alcove_decode_iovec_internal(const char *buf, size_t len, int *index,
+        alcove_iovec_t *v, int depth)
+{
+    int type = 0;
+    int arity = 0;
+
+    /* Arbitrary depth to avoid stack overflows */
+    if (depth > 16)
+        return -1;
+
+    if (alcove_get_type(buf, len, index, &type, &arity) < 0)
+        return -1;
+
+    switch (type) {
+        case ERL_STRING_EXT:
+            /* |107|length:2|bytes| */
+            alcove_iovec_append(v, buf + *index + 3, arity, 1);
+            *index += 3 + arity;
+            break;
+
+        case ERL_BINARY_EXT:
+            /* |109|length:4|bytes| */
+            alcove_iovec_append(v, buf + *index + 5, arity, 1);
+            *index += 5 + arity;
+            break;
+
+        case ERL_SMALL_INTEGER_EXT:
+            /* |97|byte| */
+            alcove_iovec_append(v, buf + *index + 1, 1, 0);
+            *index += 2;
+            break;
+
+        case ERL_NIL_EXT:
+            if (ei_decode_list_header(buf, index, &arity) < 0)
+                return -1;
+            break;
+
+        case ERL_LIST_EXT: {
+            int i = 0;
+            int length = 0;
+
+            if (ei_decode_list_header(buf, index, &length) < 0)
+                return -1;
+
+            for (i = 0; i < length; i++) {
+                if (alcove_decode_iovec_internal(buf, len, index,
+                            v, depth + 1) < 0)
+                    return -1;
+            }
+
+            /* [] */
+            if (alcove_decode_list_header(buf, len, index, &length) < 0
+                    || length != 0)
+                return -1;
+
+            }
+            break;
+
+        default:
+            return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Segments are referenced in place until the iovec array is full: the
+ * remaining data is appended to the copy buffer.
+ */
+    static void
+alcove_iovec_append(alcove_iovec_t *v, const char *p, size_t n, int inplace)
+{
+    struct iovec *last = NULL;
+
+    if (n == 0)
+        return;
+
+    last = (v->iovcnt > 0) ? &v->iov[v->iovcnt - 1] : NULL;
+
+    if (inplace && v->iovcnt < ALCOVE_IOV_MAX) {
+        v->iov[v->iovcnt].iov_base = (void *)p;
+        v->iov[v->iovcnt].iov_len = n;
+        v->iovcnt++;
+        return;
+    }
+
+    if (v->copy == NULL)
+        v->copy = alcove_arena_alloc(v->copysize);
+
+    /* extend the copy buffer if it is the last segment */
+    if (last != NULL
+            && (char *)last->iov_base + last->iov_len == v->copy + v->copylen
+            && (char *)last->iov_base >= v->copy
+            && (char *)last->iov_base < v->copy + v->copysize) {
+        (void)memcpy(v->copy + v->copylen, p, n);
+        v->copylen += n;
+        last->iov_len += n;
+        return;
+    }
+
+    if (v->iovcnt == ALCOVE_IOV_MAX) {
+        /* move the last segment into the copy buffer */
+        (void)memmove(v->copy + v->copylen, last->iov_base, last->iov_len);
+        last->iov_base = v->copy + v->copylen;
+        v->copylen += last->iov_len;
+    }
+    else {
+        last = &v->iov[v->iovcnt++];
+        last->iov_base = v->copy + v->copylen;
+        last->iov_len = 0;
+    }
+
+    (void)memcpy(v->copy + v->copylen, p, n);
+    v->copylen += n;
+    last->iov_len += n;
+}
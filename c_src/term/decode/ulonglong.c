@@ -17,9 +17,38 @@
     int
 alcove_decode_ulonglong(const char *buf, size_t len, int *index, unsigned long long *p)
 {
+    const char *s = buf + *index;
     int type = 0;
     int arity = 0;
 
+    /* fixed size integers: decode in place */
+    if (*index >= 0 && *index + 1 < len) {
+        switch (get_int8(s)) {
+            case ERL_SMALL_INTEGER_EXT:
+                *p = get_int8(s+1);
+                *index += 2;
+                return 0;
+
+            case ERL_INTEGER_EXT: {
+                int32_t n = 0;
+
+                if (*index + 5 > len)
+                    return -1;
+
+                n = get_int32(s+1);
+                if (n < 0)
+                    return -1;
+
+                *p = n;
+                *index += 5;
+                return 0;
+                }
+
+            default:
+                break;
+        }
+    }
+
     if (alcove_get_type(buf, len, index, &type, &arity) < 0)
         return -1;
 
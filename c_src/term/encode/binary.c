@@ -30,3 +30,20 @@ alcove_encode_binary(char *buf, size_t len, int *index, const void *p, long plen
 
     return ei_encode_binary(buf, index, p, plen);
 }
+
+/* Encode the header of a binary of plen bytes. The caller has written
+ * the data to buf + *index + ALCOVE_BINARY_HDRLEN. */
+    int
+alcove_encode_binary_header(char *buf, size_t len, int *index, long plen)
+{
+    if (*index < 0 || plen < 0
+            || *index + ALCOVE_BINARY_HDRLEN + plen > len)
+        return -1;
+
+    buf[*index] = ERL_BINARY_EXT;
+    put_int32(plen, buf + *index + 1);
+
+    *index += ALCOVE_BINARY_HDRLEN + plen;
+
+    return 0;
+}
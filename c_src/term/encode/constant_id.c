@@ -22,14 +22,12 @@ static int alcove_encode_atom_to_lower(char *buf, size_t len, int *index,
 alcove_encode_constant_id(char *buf, size_t len, int *index, long long val,
         const alcove_constant_t *constants)
 {
-    const alcove_constant_t *dp = NULL;
+    const char *name = alcove_lookup_constant_id(val, constants);
 
-    for (dp = constants; dp->name != NULL; dp++) {
-        if (val == dp->val)
-            return alcove_encode_atom_to_lower(buf, len, index, dp->name);
-    }
+    if (name == NULL)
+        return alcove_encode_atom(buf, len, index, "unknown");
 
-    return alcove_encode_atom(buf, len, index, "unknown");
+    return alcove_encode_atom_to_lower(buf, len, index, name);
 }
 
     static int
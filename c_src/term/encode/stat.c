@@ -0,0 +1,110 @@
+/* Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "alcove.h"
+
+static const char *alcove_stat_type(mode_t mode);
+static int alcove_encode_field(char *buf, size_t len, int *index,
+        unsigned int mask, unsigned int field, unsigned long long val);
+static int alcove_encode_time(char *buf, size_t len, int *index,
+        unsigned int mask, unsigned int field, long long val);
+
+/*
+ * Encode a stat buffer as an #alcove_stat{} record. Fields not in the
+ * mask are set to 'undefined'.
+ */
+    int
+alcove_encode_stat(char *buf, size_t len, int *index, const struct stat *st,
+        unsigned int mask)
+{
+    if (alcove_encode_tuple_header(buf, len, index, 15) < 0)
+        return -1;
+
+    if (alcove_encode_atom(buf, len, index, "alcove_stat") < 0)
+        return -1;
+
+    if (alcove_encode_atom(buf, len, index, (mask & ALCOVE_STAT_TYPE)
+                ? alcove_stat_type(st->st_mode) : "undefined") < 0)
+        return -1;
+
+    if (alcove_encode_field(buf, len, index, mask, ALCOVE_STAT_MODE,
+                st->st_mode & 07777) < 0
+            || alcove_encode_field(buf, len, index, mask, ALCOVE_STAT_NLINK,
+                st->st_nlink) < 0
+            || alcove_encode_field(buf, len, index, mask, ALCOVE_STAT_UID,
+                st->st_uid) < 0
+            || alcove_encode_field(buf, len, index, mask, ALCOVE_STAT_GID,
+                st->st_gid) < 0)
+        return -1;
+
+    /* times are in seconds since the epoch and may be negative */
+    if (alcove_encode_time(buf, len, index, mask, ALCOVE_STAT_ATIME,
+                st->st_atime) < 0
+            || alcove_encode_time(buf, len, index, mask, ALCOVE_STAT_MTIME,
+                st->st_mtime) < 0
+            || alcove_encode_time(buf, len, index, mask, ALCOVE_STAT_CTIME,
+                st->st_ctime) < 0)
+        return -1;
+
+    if (alcove_encode_field(buf, len, index, mask, ALCOVE_STAT_INO,
+                st->st_ino) < 0
+            || alcove_encode_field(buf, len, index, mask, ALCOVE_STAT_SIZE,
+                st->st_size) < 0
+            || alcove_encode_field(buf, len, index, mask, ALCOVE_STAT_BLOCKS,
+                st->st_blocks) < 0)
+        return -1;
+
+    /* always returned */
+    if (alcove_encode_ulonglong(buf, len, index, st->st_dev) < 0
+            || alcove_encode_ulonglong(buf, len, index, st->st_rdev) < 0
+            || alcove_encode_ulonglong(buf, len, index, st->st_blksize) < 0)
+        return -1;
+
+    return 0;
+}
+
+    static const char *
+alcove_stat_type(mode_t mode)
+{
+    switch (mode & S_IFMT) {
+        case S_IFBLK: return "dt_blk";
+        case S_IFCHR: return "dt_chr";
+        case S_IFDIR: return "dt_dir";
+        case S_IFIFO: return "dt_fifo";
+        case S_IFLNK: return "dt_lnk";
+        case S_IFREG: return "dt_reg";
+        case S_IFSOCK: return "dt_sock";
+        default: return "dt_unknown";
+    }
+}
+
+    static int
+alcove_encode_field(char *buf, size_t len, int *index,
+        unsigned int mask, unsigned int field, unsigned long long val)
+{
+    if (mask & field)
+        return alcove_encode_ulonglong(buf, len, index, val);
+
+    return alcove_encode_atom(buf, len, index, "undefined");
+}
+
+    static int
+alcove_encode_time(char *buf, size_t len, int *index,
+        unsigned int mask, unsigned int field, long long val)
+{
+    if (mask & field)
+        return alcove_encode_longlong(buf, len, index, val);
+
+    return alcove_encode_atom(buf, len, index, "undefined");
+}
@@ -13,19 +13,208 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 #include "alcove.h"
+#include <ctype.h>
+#include <pthread.h>
+
+/* The constant tables are indexed on first use: each table is hashed
+ * by name (case insensitive) and by value. The indexes are inherited
+ * by forked children.
+ *
+ * The tables are static: each file including a constants header has
+ * its own copy, indexed separately. The indexes are kept in a list, so
+ * the number of tables is not limited.
+ *
+ * Lookups may run in the offload thread: an index is built holding
+ * the lock and published by storing the head of the list last. The
+ * event loop does not fork while the offload thread is running a call,
+ * so a child never inherits the lock held.
+ *
+ * If a name or value appears more than once in a table, the first
+ * entry wins, so lookups return the same result as scanning the table
+ * in order.
+ */
+typedef struct alcove_constant_index {
+    struct alcove_constant_index *next;
+    const alcove_constant_t *constants;
+    u_int32_t mask;
+    const alcove_constant_t **name;
+    const alcove_constant_t **val;
+} alcove_constant_index_t;
+
+static alcove_constant_index_t *alcove_constant_index = NULL;
+static pthread_mutex_t alcove_constant_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const alcove_constant_index_t *alcove_constant_index_get(
+        const alcove_constant_t *constants);
+static alcove_constant_index_t *alcove_constant_index_new(
+        const alcove_constant_t *constants);
+static u_int32_t alcove_constant_hash_name(const char *name);
+static u_int32_t alcove_constant_hash_val(long long val);
 
     int
 alcove_lookup_constant(char *name, long long *val,
         const alcove_constant_t *constants)
 {
+    const alcove_constant_index_t *ip = NULL;
     const alcove_constant_t *dp = NULL;
+    u_int32_t i = 0;
 
-    for (dp = constants; dp->name != NULL; dp++) {
-        if (!strcasecmp(name, dp->name)) {
-            *val = dp->val;
+    ip = alcove_constant_index_get(constants);
+
+    if (ip == NULL) {
+        for (dp = constants; dp->name != NULL; dp++) {
+            if (!strcasecmp(name, dp->name)) {
+                *val = dp->val;
+                return 0;
+            }
+        }
+
+        return -1;
+    }
+
+    for (i = alcove_constant_hash_name(name) & ip->mask;
+            ip->name[i] != NULL; i = (i + 1) & ip->mask) {
+        if (!strcasecmp(name, ip->name[i]->name)) {
+            *val = ip->name[i]->val;
             return 0;
         }
     }
 
     return -1;
 }
+
+    const char *
+alcove_lookup_constant_id(long long val, const alcove_constant_t *constants)
+{
+    const alcove_constant_index_t *ip = NULL;
+    const alcove_constant_t *dp = NULL;
+    u_int32_t i = 0;
+
+    ip = alcove_constant_index_get(constants);
+
+    if (ip == NULL) {
+        for (dp = constants; dp->name != NULL; dp++) {
+            if (val == dp->val)
+                return dp->name;
+        }
+
+        return NULL;
+    }
+
+    for (i = alcove_constant_hash_val(val) & ip->mask;
+            ip->val[i] != NULL; i = (i + 1) & ip->mask) {
+        if (val == ip->val[i]->val)
+            return ip->val[i]->name;
+    }
+
+    return NULL;
+}
+
+    static const alcove_constant_index_t *
+alcove_constant_index_get(const alcove_constant_t *constants)
+{
+    alcove_constant_index_t *ip = NULL;
+
+    for (ip = __atomic_load_n(&alcove_constant_index, __ATOMIC_ACQUIRE);
+            ip != NULL; ip = ip->next) {
+        if (ip->constants == constants)
+            return ip;
+    }
+
+    (void)pthread_mutex_lock(&alcove_constant_lock);
+
+    for (ip = alcove_constant_index; ip != NULL; ip = ip->next) {
+        if (ip->constants == constants)
+            break;
+    }
+
+    /* Fall back to scanning the table if the index can't be built */
+    if (ip == NULL && (ip = alcove_constant_index_new(constants)) != NULL) {
+        ip->next = alcove_constant_index;
+        __atomic_store_n(&alcove_constant_index, ip, __ATOMIC_RELEASE);
+    }
+
+    (void)pthread_mutex_unlock(&alcove_constant_lock);
+
+    return ip;
+}
+
+    static alcove_constant_index_t *
+alcove_constant_index_new(const alcove_constant_t *constants)
+{
+    alcove_constant_index_t *ip = NULL;
+    const alcove_constant_t *dp = NULL;
+    size_t n = 0;
+    u_int32_t size = 8;
+
+    for (dp = constants; dp->name != NULL; dp++)
+        n++;
+
+    /* load factor <= 0.5 */
+    while (size < n * 2)
+        size <<= 1;
+
+    ip = calloc(1, sizeof(alcove_constant_index_t));
+    if (ip == NULL)
+        return NULL;
+
+    ip->name = calloc(size, sizeof(alcove_constant_t *));
+    ip->val = calloc(size, sizeof(alcove_constant_t *));
+
+    if (ip->name == NULL || ip->val == NULL) {
+        free(ip->name);
+        free(ip->val);
+        free(ip);
+        return NULL;
+    }
+
+    ip->mask = size - 1;
+
+    for (dp = constants; dp->name != NULL; dp++) {
+        u_int32_t i = 0;
+
+        for (i = alcove_constant_hash_name(dp->name) & ip->mask;
+                ip->name[i] != NULL; i = (i + 1) & ip->mask) {
+            if (!strcasecmp(dp->name, ip->name[i]->name))
+                break;
+        }
+
+        if (ip->name[i] == NULL)
+            ip->name[i] = dp;
+
+        for (i = alcove_constant_hash_val(dp->val) & ip->mask;
+                ip->val[i] != NULL; i = (i + 1) & ip->mask) {
+            if (dp->val == ip->val[i]->val)
+                break;
+        }
+
+        if (ip->val[i] == NULL)
+            ip->val[i] = dp;
+    }
+
+    ip->constants = constants;
+
+    return ip;
+}
+
+/* FNV-1a */
+    static u_int32_t
+alcove_constant_hash_name(const char *name)
+{
+    u_int32_t h = 2166136261U;
+
+    for ( ; *name; name++) {
+        h ^= (u_int32_t)tolower((int)(unsigned char)*name);
+        h *= 16777619U;
+    }
+
+    return h;
+}
+
+    static u_int32_t
+alcove_constant_hash_val(long long val)
+{
+    u_int64_t h = (u_int64_t)val * 0x9e3779b97f4a7c15ULL;
+
+    return (u_int32_t)(h >> 32);
+}
@@ -22,6 +22,9 @@
 -export([mounts/1, mounts/2]).
 -export([join/2,relpath/1,expand/1]).
 
+% maximum size of a file read in a single call
+-define(ALCOVE_CGROUP_READFILE_MAX, 16#ffff).
+
 -spec supported(alcove_drv:ref(),[alcove:pid_t()]) -> boolean().
 supported(Drv, Pids) ->
     foreach([
@@ -106,72 +109,68 @@ get(Drv, Pids, MntOpt, Namespace, Key) ->
 -spec write(alcove_drv:ref(),[alcove:pid_t()],file:name_all(),iodata()) ->
     {'error',file:posix()} | 'ok'.
 write(Drv, Pids, File, Bytes) ->
-    Reply = case alcove:open(Drv, Pids, File, [o_wronly], 0) of
-        {ok, FH} ->
-            Size = iolist_size(Bytes),
-            N = alcove:write(Drv, Pids, FH, Bytes),
-            _ = alcove:close(Drv, Pids, FH),
-            % XXX will crash in the case of a partial write
-            case N of
-                {ok, Size} ->
-                    ok;
-                {error, _} = Error ->
-                    Error
-            end;
-        Error ->
+    Size = iolist_size(Bytes),
+    % writefile retries partial writes: a short count means the file
+    % stopped accepting data
+    case alcove:writefile(Drv, Pids, File, Bytes, [o_wronly]) of
+        {ok, Size} ->
+            ok;
+        {ok, _} ->
+            {error, eio};
+        {error, _} = Error ->
             Error
-    end,
-    Reply.
+    end.
 
 -spec read(alcove_drv:ref(),[alcove:pid_t()],file:name_all()) ->
     {'error',file:posix()} | {'ok',binary()}.
 read(Drv, Pids, File) ->
-    Reply = case alcove:open(Drv, Pids, File, [o_rdonly], 0) of
-        {ok, FH} ->
-            N = readbuf(Drv, Pids, FH),
-            _ = alcove:close(Drv, Pids, FH),
-            N;
-        Error ->
-            Error
-    end,
-    Reply.
+    % The file is read in a single call. Files larger than a message
+    % are read in chunks.
+    case alcove:readfile(Drv, Pids, File, ?ALCOVE_CGROUP_READFILE_MAX) of
+        {error, efbig} ->
+            readbuf(Drv, Pids, File);
+        Reply ->
+            Reply
+    end.
 
 fold(Drv, MntOpt, Namespace, Fun, AccIn) ->
     fold(Drv, [], MntOpt, Namespace, Fun, AccIn).
 
 fold(Drv, Pids, MntOpt, Namespace, Fun, AccIn) ->
-    Cgroups = lists:foldl(fun({Cgroup, Opt}, Acc) ->
-                Path = join(Cgroup, Namespace),
-                IsCgroup = (MntOpt =:= <<>> orelse lists:member(MntOpt,Opt))
-                    andalso is_dir(Drv, Pids, Path),
-                case IsCgroup of
-                    true -> [Path|Acc];
-                    false -> Acc
-                end
-        end, [], cgroup(Drv, Pids)),
-
-    lists:foldl(Fun, AccIn, Cgroups).
+    Cgroups = walk(Drv, Pids, MntOpt, Namespace,
+        [{type, [dt_dir]}, {maxdepth, 0}]),
+    lists:foldl(Fun, AccIn, [ Path || {Path, _Entries} <- Cgroups ]).
 
 fold_files(Drv, MntOpt, Namespace, RegExp, Fun, AccIn) ->
     fold_files(Drv, [], MntOpt, Namespace, RegExp, Fun, AccIn).
 
-fold_files(Drv, Pids, MntOpt, Namespace, RegExp, CallerFun, AccIn) ->
+fold_files(Drv, Pids, MntOpt, Namespace, RegExp, Fun, AccIn) ->
     {ok, MP} = re:compile(RegExp),
+    Cgroups = walk(Drv, Pids, MntOpt, Namespace,
+        [{type, [dt_reg]}, {maxdepth, 1}]),
+    Files = [ filename:basename(File) || {_Path, Entries} <- Cgroups,
+        {File, dt_reg, _Size} <- Entries ],
+    Filtered = lists:filter(fun(File) ->
+                case re:run(File, MP) of
+                    nomatch ->
+                        false;
+                    {match, _} ->
+                        true
+                end
+        end, Files),
+    lists:foldl(Fun, AccIn, Filtered).
 
-    Fun = fun(Dir, Acc) ->
-            {ok, Fs} = alcove:readdir(Drv, Pids, Dir),
-            Filtered = lists:filter(fun(File) ->
-                        case re:run(File, MP) of
-                            nomatch ->
-                                false;
-                            {match, _} ->
-                                true
-                        end
-                end, Fs),
-            lists:foldl(CallerFun, Acc, Filtered)
-        end,
-
-    fold(Drv, Pids, MntOpt, Namespace, Fun, AccIn).
+% List the namespace in each cgroup mount with one walk/4 request per
+% mount: mounts without the namespace directory are skipped.
+walk(Drv, Pids, MntOpt, Namespace, Opts) ->
+    lists:foldr(fun({Cgroup, Opt}, Acc) ->
+                Path = join(Cgroup, Namespace),
+                IsCgroup = (MntOpt =:= <<>> orelse lists:member(MntOpt,Opt)),
+                case IsCgroup andalso alcove:walk(Drv, Pids, Path, Opts) of
+                    {ok, [_|_] = Entries} -> [{Path, Entries}|Acc];
+                    _ -> Acc
+                end
+        end, [], cgroup(Drv, Pids)).
 
 cgroup(Drv) ->
     cgroup(Drv, []).
@@ -183,24 +182,25 @@ cgroup(Drv, Pids) ->
 mounts(Drv) ->
     mounts(Drv, []).
 mounts(Drv, Pids) ->
-    case alcove:open(Drv, Pids, "/proc/mounts", [o_rdonly], 0) of
+    case read(Drv, Pids, "/proc/mounts") of
+        {ok, Buf} ->
+            {ok, fsentry(Buf)};
+        _ ->
+            {ok, []}
+    end.
+
+readbuf(Drv, Pids, File) ->
+    case alcove:open(Drv, Pids, File, [o_rdonly], 0) of
         {ok, FD} ->
-            Reply = case readbuf(Drv, Pids, FD) of
-                {ok, Buf} ->
-                    {ok, fsentry(Buf)};
-                Error ->
-                    Error
-            end,
+            Reply = readbuf(Drv, Pids, FD, []),
             _ = alcove:close(Drv, Pids, FD),
             Reply;
-        _ ->
-            {ok, []}
+        Error ->
+            Error
     end.
 
-readbuf(Drv, Pids, FD) ->
-    readbuf(Drv, Pids, FD, []).
 readbuf(Drv, Pids, FD, Acc) ->
-    case alcove:read(Drv, Pids, FD, 1024) of
+    case alcove:read(Drv, Pids, FD, ?ALCOVE_CGROUP_READFILE_MAX) of
         {ok, <<>>} ->
             {ok, list_to_binary(lists:reverse(Acc))};
         {ok, Buf} ->
@@ -215,21 +215,15 @@ fsentry(Buf) ->
         Entry <- Entries ].
 
 is_dir(Drv, Pids, Path) ->
-    case alcove:open(Drv, Pids, Path, [o_wronly], 0) of
-        {error,eisdir} -> true;
-        {error,_} -> false;
-        {ok, FH} ->
-            _ = alcove:close(Drv, Pids, FH),
-            false
-    end.
+    is_type(Drv, Pids, Path, dt_dir).
 
 is_file(Drv, Pids, File) ->
-    case alcove:open(Drv, Pids, File, [o_rdonly], 0) of
-        {ok, FH} ->
-            _ = alcove:close(Drv, Pids, FH),
-            true;
-        _ ->
-            false
+    is_type(Drv, Pids, File, dt_reg).
+
+is_type(Drv, Pids, Path, Type) ->
+    case alcove:stat_many(Drv, Pids, [Path], [type]) of
+        {ok, [#alcove_stat{type = Type}]} -> true;
+        _ -> false
     end.
 
 join(Cgroup, Path) ->
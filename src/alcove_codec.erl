@@ -14,10 +14,13 @@
 -module(alcove_codec).
 -include_lib("alcove/include/alcove.hrl").
 
--export([call/3, stdin/2]).
+-export([call/3, stdin/2, stdin_sync/2]).
 -export([decode/1]).
 -export([stream/1]).
 
+-define(IS_INT32(N), (is_integer(N) andalso N >= -16#80000000 andalso N =< 16#7fffffff)).
+-define(IS_UINT64(N), (is_integer(N) andalso N >= 0 andalso N =< 16#ffffffffffffffff)).
+
 -type type() :: alcove_call | alcove_stdout | alcove_stderr | alcove_event | alcove_pipe.
 -export_type([type/0]).
 
@@ -25,7 +28,43 @@
 %% Encode protocol terms to iodata
 %%
 -spec call(atom(), [alcove:pid_t()], [any()]) -> iodata().
+call(fanout, Pids, [Children, Call, Argv]) when is_list(Children), is_atom(Call), is_list(Argv) ->
+    % The call is run in each child: only calls returning a single
+    % reply can be aggregated.
+    case alcove_proto:will_return(Call) andalso not batch(Call) of
+        true -> ok;
+        false -> erlang:error(badarg, [fanout, Pids, [Children, Call, Argv]])
+    end,
+    call_1(fanout, Pids, [Children, alcove_proto:call(Call),
+            term_to_binary(list_to_tuple(Argv))]);
+call(read, Pids, [FD, Count]) when ?IS_INT32(FD), ?IS_UINT64(Count) ->
+    rawcall(read, Pids, <<FD:32/native-signed, Count:64/native-unsigned>>);
+call(write, Pids, [FD, Data]) when ?IS_INT32(FD), is_binary(Data) ->
+    rawcall(write, Pids, [<<FD:32/native-signed>>, Data]);
+call(write, Pids, [FD, Data] = Arg) when ?IS_INT32(FD), is_list(Data) ->
+    % Fall back to external term format for invalid iodata: the port
+    % returns badarg.
+    try iolist_size(Data) of
+        _ -> rawcall(write, Pids, [<<FD:32/native-signed>>, Data])
+    catch
+        error:badarg -> call_1(write, Pids, Arg)
+    end;
 call(Call, Pids, Arg) ->
+    call_1(Call, Pids, Arg).
+
+% Calls sending the reply in batches: {alcove_more, Batch}, ..., {ok, Batch}
+batch(stat_many) -> true;
+batch(walk) -> true;
+batch(_) -> false.
+
+% Calls with a fixed layout: native integers followed by an optional
+% payload
+rawcall(Call, Pids, Arg) ->
+    Size = 2 + 2 + iolist_size(Arg),
+    stdin(Pids, [<<?UINT16(Size), ?UINT16(?ALCOVE_MSG_RAWCALL),
+                   ?UINT16(alcove_proto:call(Call))>>, Arg]).
+
+call_1(Call, Pids, Arg) ->
     Bin = <<?UINT16(?ALCOVE_MSG_CALL), ?UINT16(alcove_proto:call(Call)),
     (term_to_binary(list_to_tuple(Arg)))/binary>>,
     Size = byte_size(Bin),
@@ -40,6 +79,15 @@ stdin(Pids, Data) ->
         Data,
         lists:reverse(Pids)).
 
+% The process forking the last pid replies when the data is written:
+% {alcove_pipe, Pids, {stdin_sync, ok | epipe}}
+-spec stdin_sync([alcove:pid_t(),...], iodata()) -> iodata().
+stdin_sync(Pids, Data) ->
+    [Pid|Rest] = lists:reverse(Pids),
+    Size = 2 + 4 + iolist_size(Data),
+    stdin(lists:reverse(Rest),
+        [<<?UINT16(Size), ?UINT16(?ALCOVE_MSG_STDIN_SYNC), ?UINT32(Pid)>>, Data]).
+
 %%
 %% Decode protocol binary to term
 %%
@@ -76,6 +124,12 @@ decode(<<?UINT16(Len), ?UINT16(?ALCOVE_MSG_STDOUT), ?UINT32(Pid), Data/binary>>,
 decode(<<?UINT16(Len), ?UINT16(?ALCOVE_MSG_STDERR), ?UINT32(Pid), Data/binary>>, Pids) when Len =:= 2 + 4 + byte_size(Data) ->
     {alcove_stderr, lists:reverse([Pid|Pids]), Data};
 
+decode(<<?UINT16(Len), ?UINT16(?ALCOVE_MSG_STDOUT_DEFLATE), ?UINT32(Pid), Data/binary>>, Pids) when Len =:= 2 + 4 + byte_size(Data) ->
+    {alcove_stdout, lists:reverse([Pid|Pids]), zlib:uncompress(Data)};
+
+decode(<<?UINT16(Len), ?UINT16(?ALCOVE_MSG_STDERR_DEFLATE), ?UINT32(Pid), Data/binary>>, Pids) when Len =:= 2 + 4 + byte_size(Data) ->
+    {alcove_stderr, lists:reverse([Pid|Pids]), zlib:uncompress(Data)};
+
 decode(<<?UINT16(Len), ?UINT16(?ALCOVE_MSG_CALL), Data/binary>>, Pids) when Len =:= 2 + byte_size(Data) ->
     {alcove_call, lists:reverse(Pids), binary_to_term(Data)};
 
@@ -86,4 +140,16 @@ decode(<<?UINT16(Len), ?UINT16(?ALCOVE_MSG_CTL), Data/binary>>, Pids) when Len =
     {alcove_ctl, lists:reverse(Pids), binary_to_term(Data)};
 
 decode(<<?UINT16(Len), ?UINT16(?ALCOVE_MSG_PIPE), Data/binary>>, Pids) when Len =:= 2 + byte_size(Data) ->
-    {alcove_pipe, lists:reverse(Pids), binary_to_term(Data)}.
+    {alcove_pipe, lists:reverse(Pids), binary_to_term(Data)};
+
+decode(<<?UINT16(Len), ?UINT16(?ALCOVE_MSG_RAWCALL), Data/binary>>, Pids) when Len =:= 2 + byte_size(Data) ->
+    {alcove_call, lists:reverse(Pids), rawcall(Data)}.
+
+rawcall(<<?ALCOVE_RAW_ATOM, Atom/binary>>) ->
+    binary_to_atom(Atom, latin1);
+rawcall(<<?ALCOVE_RAW_INT64, N:64/native-signed>>) ->
+    {ok, N};
+rawcall(<<?ALCOVE_RAW_BINARY, Data/binary>>) ->
+    {ok, Data};
+rawcall(<<?ALCOVE_RAW_ERROR, Atom/binary>>) ->
+    {error, binary_to_atom(Atom, latin1)}.
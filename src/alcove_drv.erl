@@ -19,8 +19,9 @@
 -export([start/0, start/1, start/2, stop/1]).
 -export([start_link/0, start_link/1, start_link/2]).
 -export([call/5]).
--export([stdin/3, stdout/3, stderr/3, event/3]).
--export([raw/1, getopts/1, progname/0, port/1]).
+-export([stdin/3, stdin_sync/4, stdin_credit/3, stdout/3, stderr/3,
+         event/3]).
+-export([raw/1, getopts/1, progname/0, port/1, constant_tables/1]).
 
 %% gen_server callbacks
 -export([init/1, handle_call/3, handle_cast/2, handle_info/2,
@@ -34,7 +35,9 @@
           raw = false,
           port :: port(),
           fdctl :: port(),
-          buf = <<>> :: binary()
+          buf = <<>> :: binary(),
+          constant :: ets:tid(),
+          constant_exec :: ets:tid()
          }).
 
 -spec start() -> 'ignore' | {'error',_} | {'ok',pid()}.
@@ -67,13 +70,18 @@ stop(Drv) ->
     ok.
 
 -spec call(ref(),[alcove:pid_t()],atom(),list(),timeout()) -> term().
-call(Drv, Pids, Command, Argv, Timeout)
-    when is_list(Pids), is_atom(Command), is_list(Argv),
+call(Drv, Pids, Command, Argv0, Timeout)
+    when is_list(Pids), is_atom(Command), is_list(Argv0),
          (is_integer(Timeout) orelse Timeout =:= infinity) ->
+    Argv = constant_resolve(Drv, Pids, Command, Argv0, Timeout),
     Data = alcove_codec:call(Command, Pids, Argv),
     case sync_send(Drv, Data) of
         ok ->
-            call_reply(Drv, Pids, alcove_proto:will_return(Command), Timeout);
+            Reply = call_more(Drv, Pids,
+                call_reply(Drv, Pids, alcove_proto:will_return(Command), Timeout),
+                Timeout, []),
+            ok = constant_exec(Drv, Pids, Command, Reply),
+            Reply;
         Error ->
             Error
     end.
@@ -100,6 +108,38 @@ send(Drv, Data) ->
 stdin(Drv, Pids, Data) ->
     send(Drv, alcove_codec:stdin(Pids, Data)).
 
+% Returns when the data has been written to the stdin of the process
+-spec stdin_sync(ref(),[alcove:pid_t(),...],iodata(),timeout()) -> 'ok' | {'error', 'epipe'} | {alcove_error, any()}.
+stdin_sync(Drv, Pids, Data, Timeout) ->
+    case send(Drv, alcove_codec:stdin_sync(Pids, Data)) of
+        ok ->
+            receive
+                {alcove_pipe, Drv, Pids, {stdin_sync, ok}} ->
+                    ok;
+                {alcove_pipe, Drv, Pids, {stdin_sync, Error}} ->
+                    {error, Error};
+                {alcove_ctl, Drv, Pids, badpid} ->
+                    {alcove_error, badpid}
+            after
+                Timeout ->
+                    {alcove_error, timeout}
+            end;
+        Error ->
+            Error
+    end.
+
+% Sent when data queued for the stdin of the process has been written
+% after data was refused
+-spec stdin_credit(ref(),[alcove:pid_t()],timeout()) -> 'false' | non_neg_integer().
+stdin_credit(Drv, Pids, Timeout) ->
+    receive
+        {alcove_pipe, Drv, Pids, {stdin_credit, Bytes}} ->
+            Bytes
+    after
+        Timeout ->
+            false
+    end.
+
 -spec stdout(ref(),[alcove:pid_t()],timeout()) -> 'false' | binary() | {alcove_error, any()} | {alcove_pipe, integer()}.
 stdout(Drv, Pids, Timeout) ->
     reply(Drv, Pids, alcove_stdout, Timeout).
@@ -120,6 +160,26 @@ raw(Drv) ->
 port(Drv) ->
     gen_server:call(Drv, port).
 
+% The ETS tables caching constants resolved by name and the fork chains
+% which have called exec(). The tables are owned by the driver: their
+% identifiers are requested once and kept in the process dictionary of
+% the owner.
+-spec constant_tables(ref()) -> {ets:tid(), ets:tid()} | 'undefined'.
+constant_tables(Drv) ->
+    Key = {alcove_constant, Drv},
+    case get(Key) of
+        undefined ->
+            case catch gen_server:call(Drv, constant, infinity) of
+                {ok, Tab, Exec} ->
+                    _ = put(Key, {Tab, Exec}),
+                    {Tab, Exec};
+                _ ->
+                    undefined
+            end;
+        Tables ->
+            Tables
+    end.
+
 %%--------------------------------------------------------------------
 %%% Callbacks
 %%--------------------------------------------------------------------
@@ -167,10 +227,15 @@ init([Owner, Options]) ->
             % Decrease the link count of the fifo. The fifo is deleted in
             % the port because the port may be running as a different user.
             ok = call_unlink(Port, Fifo),
+
             {ok, #state{
                     port = Port,
                     fdctl = Fdctl,
-                    owner = Owner
+                    owner = Owner,
+                    constant = ets:new(alcove_constant,
+                        [set, public, {read_concurrency, true}]),
+                    constant_exec = ets:new(alcove_constant_exec,
+                        [set, public])
                 }};
         {'EXIT', Port, normal} ->
             {stop, {error, port_init_failed}};
@@ -188,6 +253,10 @@ handle_call(raw, {Owner,_Tag}, #state{owner = Owner} = State) ->
 handle_call(port, {Owner,_Tag}, #state{owner = Owner, port = Port} = State) ->
     {reply, Port, State};
 
+handle_call(constant, {Owner,_Tag}, #state{owner = Owner, constant = Tab,
+        constant_exec = Exec} = State) ->
+    {reply, {ok, Tab, Exec}, State};
+
 handle_call(stop, _From, State) ->
     {stop, normal, ok, State};
 
@@ -222,9 +291,11 @@ code_change(_OldVsn, State, _Extra) ->
 handle_info({Port, {data, Data}}, #state{raw = true, port = Port, buf = Buf, owner = Owner} = State) ->
     Owner ! {alcove_stdout, self(), [], <<Buf/binary, Data/binary>>},
     {noreply, State};
-handle_info({Port, {data, Data}}, #state{port = Port, buf = Buf, owner = Owner} = State) ->
+handle_info({Port, {data, Data}}, #state{port = Port, buf = Buf, owner = Owner,
+        constant_exec = Exec} = State) ->
     {Msgs, Rest} = alcove_codec:stream(<<Buf/binary, Data/binary>>),
     Terms = [ alcove_codec:decode(Msg) || Msg <- Msgs ],
+    _ = [ constant_exit(Exec, Pids, Term) || {alcove_event, Pids, Term} <- Terms ],
     _ = [ Owner ! {Tag, self(), Pids, Term} || {Tag, Pids, Term} <- Terms ],
     {noreply, State#state{buf = Rest}};
 
@@ -251,7 +322,7 @@ call_reply(Drv, Pids, false, Timeout) ->
             ok;
         {alcove_ctl, Drv, Pids, Error} ->
             {alcove_error, Error};
-        {alcove_pipe, Drv, Pids, Bytes} ->
+        {alcove_pipe, Drv, Pids, Bytes} when is_integer(Bytes) ->
             {alcove_error, {eagain, Bytes}};
         {alcove_call, Drv, Pids, Error} when Error =:= badarg; Error =:= undef ->
             {alcove_error, Error};
@@ -273,7 +344,7 @@ call_reply(Drv, Pids, true, Timeout) ->
             {alcove_error, Event};
         {alcove_call, Drv, Pids, Error} when Error =:= badarg; Error =:= undef ->
             {alcove_error, Error};
-        {alcove_pipe, Drv, Pids, Bytes} ->
+        {alcove_pipe, Drv, Pids, Bytes} when is_integer(Bytes) ->
             {alcove_error, {eagain, Bytes}};
         {alcove_call, Drv, Pids, Event} ->
             Event
@@ -282,6 +353,152 @@ call_reply(Drv, Pids, true, Timeout) ->
             {alcove_error, timeout}
     end.
 
+% Calls returning a list may send the list in batches before the
+% final reply: {alcove_more, Batch}, ..., {ok, Batch}
+call_more(Drv, Pids, {alcove_more, Batch}, Timeout, Acc) ->
+    call_more(Drv, Pids, call_reply(Drv, Pids, true, Timeout), Timeout,
+        [Batch|Acc]);
+call_more(_Drv, _Pids, {ok, Batch}, _Timeout, [_|_] = Acc) ->
+    {ok, lists:append(lists:reverse([Batch|Acc]))};
+call_more(_Drv, _Pids, Reply, _Timeout, _Acc) ->
+    Reply.
+
+%%--------------------------------------------------------------------
+%%% Constants
+%%--------------------------------------------------------------------
+
+% Constants passed by name are resolved once per port using the
+% *_constant call and cached in an ETS table owned by the driver. The
+% port receives the integer value.
+%
+% A process which has called exec() may be running a different alcove
+% binary, possibly built for another OS: constants for calls to the
+% process and its children are sent by name.
+
+% The position of the argument and the call used to resolve it
+constant_args(cap_fcntls_limit) -> [{2, cap_constant}];
+constant_args(clone) -> [{1, clone_constant}];
+constant_args(fcntl) -> [{2, fcntl_constant}];
+constant_args(getrlimit) -> [{1, rlimit_constant}];
+constant_args(ioctl) -> [{2, ioctl_constant}];
+constant_args(kill) -> [{2, signal_constant}];
+constant_args(mount) -> [{4, mount_constant}];
+constant_args(open) -> [{2, file_constant}];
+constant_args(prctl) -> [{1, prctl_constant}];
+constant_args(ptrace) -> [{1, ptrace_constant}];
+constant_args(seccomp) -> [{1, seccomp_constant}, {2, seccomp_constant}];
+constant_args(setns) -> [{2, clone_constant}];
+constant_args(setrlimit) -> [{1, rlimit_constant}];
+constant_args(sigaction) -> [{1, signal_constant}];
+constant_args(unshare) -> [{1, clone_constant}];
+constant_args(_) -> [].
+
+constant_resolve(Drv, Pids, Command, Argv, Timeout) ->
+    case constant_args(Command) of
+        [] ->
+            Argv;
+        Args ->
+            case constant_cacheable(Drv, Pids) of
+                {true, Tab} ->
+                    lists:foldl(fun({N, Fun}, Acc) ->
+                                constant_resolve_nth(Drv, Tab, Fun, N, Acc,
+                                    Timeout)
+                        end,
+                        Argv,
+                        Args);
+                false ->
+                    Argv
+            end
+    end.
+
+constant_resolve_nth(Drv, Tab, Fun, N, Argv, Timeout) when N =< length(Argv) ->
+    {Head, [Arg|Tail]} = lists:split(N-1, Argv),
+    Head ++ [constant_resolve_arg(Drv, Tab, Fun, Arg, Timeout)|Tail];
+constant_resolve_nth(_Drv, _Tab, _Fun, _N, Argv, _Timeout) ->
+    Argv.
+
+constant_resolve_arg(Drv, Tab, Fun, Arg, Timeout) when is_atom(Arg) ->
+    constant(Drv, Tab, Fun, Arg, Timeout);
+constant_resolve_arg(Drv, Tab, Fun, [Arg|Rest], Timeout) when is_atom(Arg) ->
+    [constant(Drv, Tab, Fun, Arg, Timeout)|
+        constant_resolve_arg(Drv, Tab, Fun, Rest, Timeout)];
+constant_resolve_arg(Drv, Tab, Fun, [Arg|Rest], Timeout) ->
+    [Arg|constant_resolve_arg(Drv, Tab, Fun, Rest, Timeout)];
+constant_resolve_arg(_Drv, _Tab, _Fun, Arg, _Timeout) ->
+    Arg.
+
+constant(Drv, Tab, Fun, Name, Timeout) ->
+    case ets:lookup(Tab, {Fun, Name}) of
+        [{_, Val}] ->
+            Val;
+        [] ->
+            % Constants are resolved by the port process
+            case call(Drv, [], Fun, [Name], Timeout) of
+                Val when is_integer(Val) ->
+                    true = ets:insert(Tab, {{Fun, Name}, Val}),
+                    Val;
+                _ ->
+                    % unknown or unsupported: the port returns the error
+                    Name
+            end
+    end.
+
+% The fork chains which have called exec() are stored in an ETS table
+% owned by the driver.
+constant_cacheable(Drv, Pids) ->
+    case constant_tables(Drv) of
+        undefined ->
+            false;
+        {Tab, Exec} ->
+            try lists:any(fun(N) ->
+                            ets:member(Exec, lists:sublist(Pids, N))
+                    end,
+                    lists:seq(0, length(Pids))) of
+                false -> {true, Tab};
+                true -> false
+            catch
+                error:badarg ->
+                    % the driver has exited
+                    _ = erase({alcove_constant, Drv}),
+                    false
+            end
+    end.
+
+constant_exec(Drv, Pids, Command, ok) when Command =:= execve;
+        Command =:= execvp; Command =:= fexecve ->
+    case constant_tables(Drv) of
+        undefined ->
+            ok;
+        {_Tab, Exec} ->
+            _ = (catch ets:insert(Exec, {Pids})),
+            ok
+    end;
+constant_exec(Drv, Pids, Command, {ok, Pid}) when Command =:= fork;
+        Command =:= clone ->
+    % a new process has not called exec(): remove any chain left by a
+    % process which used the same pid
+    case constant_tables(Drv) of
+        undefined ->
+            ok;
+        {_Tab, Exec} ->
+            _ = (catch ets:match_delete(Exec, {Pids ++ [Pid|'_']})),
+            ok
+    end;
+constant_exec(_Drv, _Pids, _Command, _Reply) ->
+    ok.
+
+% The chains of an exited process and its descendants are removed
+constant_exit(Exec, Pids, {exited, Exited}) ->
+    _ = [ ets:match_delete(Exec, {Pids ++ [element(1, Child)|'_']})
+          || Child <- Exited, is_tuple(Child) ],
+    ok;
+constant_exit(Exec, Pids, Event) when is_tuple(Event), tuple_size(Event) > 1,
+        (element(1, Event) =:= exit_status orelse element(1, Event) =:= termsig) ->
+    true = ets:match_delete(Exec, {Pids ++ '_'}),
+    ok;
+constant_exit(_Exec, _Pids, _Event) ->
+    ok.
+
 reply(Drv, Pids, Type, Timeout) ->
     receive
         {alcove_ctl, Drv, Pids, fdctl_closed} ->
@@ -290,7 +507,7 @@ reply(Drv, Pids, Type, Timeout) ->
             {alcove_error, Error};
         {alcove_call, Drv, Pids, Error} when Error =:= badarg; Error =:= undef ->
             {alcove_error, Error};
-        {alcove_pipe, Drv, Pids, Bytes} ->
+        {alcove_pipe, Drv, Pids, Bytes} when is_integer(Bytes) ->
             {alcove_pipe, {eagain, Bytes}};
         {Type, Drv, Pids, Event} ->
             Event
@@ -38,6 +38,7 @@
         chmod/1,
         clone_constant/1,
         connect/1,
+        constant_cache/1,
         env/1,
         eof/1,
         errno_id/1,
@@ -46,6 +47,7 @@
         execvp/1,
         execvp_mid_chain/1,
         execvp_with_signal/1,
+        fanout/1,
         fcntl/1,
         fexecve/1,
         file_constant/1,
@@ -62,6 +64,25 @@
         mount_constant/1,
         open/1,
         pipe_buf/1,
+        pwritev/1,
+        preadv/1,
+        readfile/1,
+        walk/1,
+        stat/1,
+        copy_file_range/1,
+        fork_stdio/1,
+        bridge/1,
+        offload/1,
+        watch/1,
+        timer/1,
+        read_budget/1,
+        stdin_queue/1,
+        stdin_refused/1,
+        stdout_flush/1,
+        compress/1,
+        sigevent/1,
+        exit_rusage/1,
+        stats/1,
         pledge/1,
         portstress/1,
         prctl/1,
@@ -86,6 +107,8 @@
         stream/1,
         symlink/1,
         syscall_constant/1,
+        arena/1,
+        getdents/1,
         tmpfs/1,
         unshare/1,
         version/1,
@@ -107,8 +130,10 @@ all() ->
         ioctl_constant,
         rlimit_constant,
         signal_constant,
+        constant_cache,
         errno_id,
         children,
+        fanout,
         getpid,
         setopt,
         event,
@@ -148,7 +173,26 @@ all() ->
         ioctl,
         symlink,
         execvp_mid_chain,
-        pipe_buf
+        pipe_buf,
+        pwritev,
+        preadv,
+        readfile,
+        walk,
+        stat,
+        copy_file_range,
+        fork_stdio,
+        bridge,
+        offload,
+        watch,
+        timer,
+        read_budget,
+        stdin_queue,
+        stdin_refused,
+        stdout_flush,
+        compress,
+        sigevent,
+        exit_rusage,
+        stats
     ].
 
 groups() ->
@@ -159,6 +203,8 @@ groups() ->
                 prctl_constant,
                 ptrace_constant,
                 syscall_constant,
+                arena,
+                getdents,
                 setns,
                 unshare,
                 prctl,
@@ -341,6 +387,43 @@ syscall_constant(Config) ->
 
     ok.
 
+constant_cache(Config) ->
+    Drv = ?config(drv, Config),
+    Child = ?config(child, Config),
+
+    % Constants passed by name are resolved once and cached
+    ok = alcove:kill(Drv, [], Child, sigcont),
+    SIGCONT = alcove:signal_constant(Drv, [], sigcont),
+    {Tab, Exec} = alcove_drv:constant_tables(Drv),
+    [{_, SIGCONT}] = ets:lookup(Tab, {signal_constant, sigcont}),
+    ok = alcove:kill(Drv, [], Child, sigcont),
+
+    % Unknown constants are passed to the port
+    {error, enotsup} = alcove:kill(Drv, [], Child, nonexist),
+    [] = ets:lookup(Tab, {signal_constant, nonexist}),
+
+    % A chain which has called exec() is removed when the process exits
+    true = alcove:setopt(Drv, [Child], termsig, 1),
+    {ok, Cat} = alcove:fork(Drv, [Child]),
+    false = ets:member(Exec, [Child, Cat]),
+    ok = alcove:execvp(Drv, [Child, Cat], "/bin/cat", ["/bin/cat"]),
+    true = ets:member(Exec, [Child, Cat]),
+    ok = alcove:kill(Drv, [Child], Cat, 9),
+    {termsig, sigkill} = alcove:event(Drv, [Child, Cat], 5000),
+    false = ets:member(Exec, [Child, Cat]),
+
+    % The tables are removed when the port is stopped
+    Ref = monitor(process, Drv),
+    ok = alcove_drv:stop(Drv),
+    receive
+        {'DOWN', Ref, process, Drv, _} -> ok
+    after
+        5000 -> timeout
+    end,
+    undefined = ets:info(Tab),
+    undefined = ets:info(Exec),
+    ok.
+
 errno_id(Config) ->
     Drv = ?config(drv, Config),
 
@@ -359,6 +442,55 @@ children(Config) ->
     [#alcove_pid{fdctl = -2}] = alcove:children(Drv, [Child]),
     ok = alcove:eof(Drv, [Child]).
 
+fanout(Config) ->
+    Drv = ?config(drv, Config),
+    Child = ?config(child, Config),
+
+    Forks = [ begin {ok, Pid} = alcove:fork(Drv, [Child]), Pid end
+              || _ <- lists:seq(1,4) ],
+
+    % The children run the call and reply with their PIDs
+    Reply = alcove:fanout(Drv, [Child], Forks, getpid, []),
+    Forks = [ Pid || {Pid, Pid} <- Reply ],
+
+    % Replies are returned in the order of the list of PIDs
+    [{Pid0, ok}, {Pid1, ok}|_] = alcove:fanout(Drv, [Child],
+        lists:reverse(Forks), chdir, ["/"]),
+    [Pid0, Pid1|_] = lists:reverse(Forks),
+
+    % Errors are returned per child
+    [{_, {error, enoent}}|_] = alcove:fanout(Drv, [Child], Forks,
+        chdir, ["/nonexistent"]),
+    [{16#7ffffff0, {error, esrch}}] = alcove:fanout(Drv, [Child],
+        [16#7ffffff0], getpid, []),
+
+    % Calls without a reply can't be aggregated
+    {'EXIT',{badarg,_}} = (catch alcove:fanout(Drv, [Child], Forks,
+            exit, [0])),
+
+    % Calls replying in batches can't be aggregated
+    {'EXIT',{badarg,_}} = (catch alcove:fanout(Drv, [Child], Forks,
+            walk, ["/", []])),
+
+    % Exec'ed children can't run calls
+    [Exec|_] = Forks,
+    ok = alcove:execvp(Drv, [Child,Exec], "/bin/cat", ["/bin/cat"]),
+    [{Exec, {error, enotsup}}] = alcove:fanout(Drv, [Child], [Exec],
+        getpid, []),
+
+    % A child which does not reply before the deadline returns an error
+    [_, Running, Stopped|_] = Forks,
+    5000 = alcove:getopt(Drv, [Child], fanout_timeout),
+    true = alcove:setopt(Drv, [Child], fanout_timeout, 500),
+    ok = alcove:kill(Drv, [Child], Stopped, sigstop),
+    [{Running, Running}, {Stopped, {error, etimedout}}] = alcove:fanout(Drv,
+        [Child], [Running, Stopped], getpid, []),
+    ok = alcove:kill(Drv, [Child], Stopped, sigcont),
+    % the late reply is discarded
+    Stopped = alcove:getpid(Drv, [Child, Stopped]),
+
+    [] = alcove:fanout(Drv, [], [], getpid, []).
+
 getpid(Config) ->
     Drv = ?config(drv, Config),
     Child = ?config(child, Config),
@@ -840,6 +972,54 @@ execve(Config) ->
     <<"FOO=bar\nBAR=1234567\n">> = alcove:stdout(Drv, [Child0], 5000),
     false = alcove:stdout(Drv, [Child1], 2000).
 
+% memory allocated while decoding a call is released when the call
+% returns
+arena(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+
+    Argv = [binary:copy(<<"x">>, 1024) || _ <- lists:seq(1, 16)],
+    Call = fun() ->
+            {error, enoent} = alcove:execve(Drv, [Child],
+                "/nonexistent", Argv, Argv)
+    end,
+
+    [Call() || _ <- lists:seq(1, 10)],
+    RSS0 = rss(Drv, Child),
+    [Call() || _ <- lists:seq(1, 1000)],
+    RSS1 = rss(Drv, Child),
+
+    % pages
+    true = RSS1 - RSS0 < 1024,
+
+    % element arrays of cstruct arguments
+    Cstruct = lists:append([[<<N:32/native>>, {ptr, 64}, {ptr, <<"x">>}]
+                            || N <- lists:seq(1, 64)]),
+    Alloc = fun() ->
+            {ok, _, _} = alcove:alloc(Drv, [Child],
+                [<<N:32/native>> || N <- lists:seq(1, 256)])
+    end,
+    Elem = case os:type() of
+        {unix, linux} ->
+            fun() ->
+                    Alloc(),
+                    {error, _} = alcove:ptrace(Drv, [Child],
+                        ptrace_peekdata, 16#7ffffff0, Cstruct, Cstruct),
+                    {error, _} = alcove:seccomp(Drv, [Child],
+                        16#ffff, 0, Cstruct)
+            end;
+        _ ->
+            Alloc
+    end,
+
+    [Elem() || _ <- lists:seq(1, 10)],
+    RSS2 = rss(Drv, Child),
+    [Elem() || _ <- lists:seq(1, 1000)],
+    RSS3 = rss(Drv, Child),
+
+    true = RSS3 - RSS2 < 1024.
+
 execvp_with_signal(Config) ->
     Drv = ?config(drv, Config),
 
@@ -1114,6 +1294,791 @@ pipe_buf(Config) ->
 
     {ok, _} = Reply.
 
+pwritev(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+
+    File = "/tmp/alcove_pwritev." ++ integer_to_list(Child),
+    {ok, FD} = alcove:open(Drv, [Child], File,
+        [o_rdwr, o_creat, o_trunc], 8#600),
+    ok = alcove:unlink(Drv, [Child], File),
+
+    % write at the current offset
+    {ok, 6} = alcove:pwritev(Drv, [Child], FD,
+        [<<"ab">>, "cd", [$e, [$f]]], -1),
+    % write at an offset: the file offset is not changed
+    {ok, 3} = alcove:pwritev(Drv, [Child], FD, [$X, <<"YZ">>], 1),
+    {ok, 1} = alcove:write(Drv, [Child], FD, [[], <<"g">>]),
+
+    ok = alcove:lseek(Drv, [Child], FD, 0, 0),
+    {ok, <<"aXYZefg">>} = alcove:read(Drv, [Child], FD, 1024),
+
+    % more segments than entries in the iovec array: the remainder is copied
+    Many = [[<<N:16>>, N rem 256] || N <- lists:seq(1, 2048)],
+    Bin = iolist_to_binary(Many),
+    Size = byte_size(Bin),
+    {ok, Size} = alcove:write(Drv, [Child], FD, Many),
+    {ok, Size} = alcove:pwritev(Drv, [Child], FD, Many, 7 + Size),
+
+    Expect = <<Bin/binary, Bin/binary>>,
+    ok = alcove:lseek(Drv, [Child], FD, 7, 0),
+    {ok, Expect} = alcove:read(Drv, [Child], FD, Size * 2),
+
+    {'EXIT',{badarg,_}} = (catch alcove:pwritev(Drv, [Child], FD, [256], -1)),
+    {'EXIT',{badarg,_}} = (catch alcove:pwritev(Drv, [Child], FD, "x", -2)).
+
+preadv(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+
+    File = "/tmp/alcove_preadv." ++ integer_to_list(Child),
+    {ok, FD} = alcove:open(Drv, [Child], File,
+        [o_rdwr, o_creat, o_trunc], 8#600),
+    ok = alcove:unlink(Drv, [Child], File),
+
+    {ok, 10} = alcove:write(Drv, [Child], FD, <<"0123456789">>),
+
+    % the file offset is not changed
+    {ok, <<"234">>} = alcove:pread(Drv, [Child], FD, 3, 2),
+    {ok, <<>>} = alcove:read(Drv, [Child], FD, 10),
+    {ok, <<"89">>} = alcove:pread(Drv, [Child], FD, 1024, 8),
+
+    {ok, [<<"0">>, <<"12">>, <<"345">>]} = alcove:preadv(Drv, [Child], FD,
+        [1, 2, 3], 0),
+    {ok, [<<"78">>, <<"9">>, <<>>]} = alcove:preadv(Drv, [Child], FD,
+        [2, 1024, 3], 7),
+    {ok, []} = alcove:preadv(Drv, [Child], FD, [], 0),
+
+    ok = alcove:lseek(Drv, [Child], FD, 4, 0),
+    {ok, [<<"45">>, <<"6789">>]} = alcove:preadv(Drv, [Child], FD,
+        [2, 4], -1),
+    {ok, <<>>} = alcove:read(Drv, [Child], FD, 10).
+
+readfile(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+
+    File = "/tmp/alcove_readfile." ++ integer_to_list(Child),
+
+    {ok, 6} = alcove:writefile(Drv, [Child], File, [<<"abc">>, "de", $f],
+        [o_creat, o_trunc]),
+    {ok, <<"abcdef">>} = alcove:readfile(Drv, [Child], File, 1024),
+    {ok, <<"abcdef">>} = alcove:readfile(Drv, [Child], File, 6),
+    {error, efbig} = alcove:readfile(Drv, [Child], File, 5),
+
+    {ok, 3} = alcove:writefile(Drv, [Child], File, <<"ghi">>,
+        [o_wronly, o_append]),
+    {ok, <<"abcdefghi">>} = alcove:readfile(Drv, [Child], File, 1024),
+
+    ok = alcove:unlink(Drv, [Child], File),
+
+    {error, enoent} = alcove:readfile(Drv, [Child], File, 1024),
+    {error, enoent} = alcove:writefile(Drv, [Child], File, <<"x">>, []),
+
+    % files without a size
+    case os:type() of
+        {unix, linux} ->
+            {ok, Mounts} = alcove:readfile(Drv, [Child], "/proc/self/mounts",
+                16#ffff),
+            true = byte_size(Mounts) > 0;
+        _ ->
+            ok
+    end.
+
+getdents(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+
+    Dir = "/tmp/alcove_getdents." ++ integer_to_list(Child),
+    ok = alcove:mkdir(Drv, [Child], Dir, 8#700),
+
+    % the directory does not fit in a single message
+    Files = [list_to_binary(["file", integer_to_list(N),
+            lists:duplicate(200, $x)]) || N <- lists:seq(1, 1000)],
+    [{ok, 0} = alcove:writefile(Drv, [Child], [Dir, "/", File], <<>>,
+            [o_creat]) || File <- Files],
+    ok = alcove:mkdir(Drv, [Child], [Dir, "/subdir"], 8#700),
+
+    {error, e2big} = alcove:readdir(Drv, [Child], Dir),
+
+    {ok, FD} = alcove:open(Drv, [Child], Dir, [o_rdonly, o_directory], 0),
+    Entries = getdents(Drv, Child, FD, []),
+    ok = alcove:close(Drv, [Child], FD),
+
+    1003 = length(Entries),
+    Sorted = lists:sort(Files),
+    Sorted = lists:sort([Name || {Name, dt_reg, _} <- Entries]),
+    [<<".">>, <<"..">>, <<"subdir">>] = lists:sort([Name ||
+            {Name, dt_dir, Ino} <- Entries, is_integer(Ino)]),
+
+    [ok = alcove:unlink(Drv, [Child], [Dir, "/", File]) || File <- Files],
+    ok = alcove:rmdir(Drv, [Child], [Dir, "/subdir"]),
+    ok = alcove:rmdir(Drv, [Child], Dir).
+
+getdents(Drv, Child, FD, Acc) ->
+    case alcove:getdents(Drv, [Child], FD) of
+        {ok, []} ->
+            lists:append(lists:reverse(Acc));
+        {ok, Entries} ->
+            getdents(Drv, Child, FD, [Entries|Acc])
+    end.
+
+walk(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+
+    Root = "/tmp/alcove_walk." ++ integer_to_list(Child),
+    Dirs = [Root, [Root, "/a"], [Root, "/a/b"]],
+    [ok = alcove:mkdir(Drv, [Child], Dir, 8#700) || Dir <- Dirs],
+    {ok, 3} = alcove:writefile(Drv, [Child], [Root, "/a/b/c.txt"], "abc",
+        [o_creat]),
+    {ok, 0} = alcove:writefile(Drv, [Child], [Root, "/a/d.log"], "",
+        [o_creat]),
+
+    Path = fun(P) -> iolist_to_binary([Root, P]) end,
+
+    {ok, All} = alcove:walk(Drv, [Child], Root, []),
+    [{Path(""), dt_dir, _},
+     {Path("/a"), dt_dir, _},
+     {Path("/a/b"), dt_dir, _},
+     {Path("/a/b/c.txt"), dt_reg, 3},
+     {Path("/a/d.log"), dt_reg, 0}] = lists:sort(All),
+
+    {ok, [{_, dt_dir, _}, {_, dt_dir, _}]} = alcove:walk(Drv, [Child], Root,
+        [{maxdepth, 1}]),
+    {ok, [{_, dt_reg, 3}]} = alcove:walk(Drv, [Child], Root,
+        [{match, "*.txt"}]),
+    {ok, [{_, dt_reg, 0}]} = alcove:walk(Drv, [Child], Root,
+        [{prefix, "d."}, {type, [dt_reg]}]),
+    {ok, []} = alcove:walk(Drv, [Child], Root, [{type, [dt_sock]}]),
+
+    {error, enoent} = alcove:walk(Drv, [Child], [Root, "/nonexistent"], []),
+    {'EXIT',{badarg,_}} = (catch alcove:walk(Drv, [Child], Root,
+            [{type, [dt_invalid]}])),
+
+    % returned in batches
+    Files = [[Root, "/a/", lists:duplicate(200, $x), integer_to_list(N)]
+        || N <- lists:seq(1, 1000)],
+    [{ok, 0} = alcove:writefile(Drv, [Child], File, <<>>, [o_creat])
+        || File <- Files],
+    {ok, Batch} = alcove:walk(Drv, [Child], Root, [{prefix, "xxx"}]),
+    1000 = length(Batch),
+
+    [ok = alcove:unlink(Drv, [Child], File) || File <- Files],
+    ok = alcove:unlink(Drv, [Child], [Root, "/a/b/c.txt"]),
+    ok = alcove:unlink(Drv, [Child], [Root, "/a/d.log"]),
+    [ok = alcove:rmdir(Drv, [Child], Dir) || Dir <- lists:reverse(Dirs)].
+
+stat(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+
+    File = "/tmp/alcove_stat." ++ integer_to_list(Child),
+    Link = File ++ ".lnk",
+    {ok, 3} = alcove:writefile(Drv, [Child], File, "abc", [o_creat]),
+    ok = alcove:chmod(Drv, [Child], File, 8#640),
+    ok = alcove:symlink(Drv, [Child], File, Link),
+
+    {ok, #alcove_stat{type = dt_reg, mode = 8#640, size = 3, nlink = 1,
+            ino = Ino}} = alcove:stat(Drv, [Child], File),
+    {ok, #alcove_stat{type = dt_reg, ino = Ino}} = alcove:stat(Drv, [Child],
+        Link),
+    {ok, #alcove_stat{type = dt_lnk}} = alcove:lstat(Drv, [Child], Link),
+    {ok, #alcove_stat{type = dt_lnk}} = alcove:fstatat(Drv, [Child],
+        at_fdcwd, Link, [at_symlink_nofollow]),
+    {ok, #alcove_stat{type = dt_dir}} = alcove:stat(Drv, [Child], "/tmp"),
+    {error, enoent} = alcove:stat(Drv, [Child], File ++ ".nonexistent"),
+
+    {ok, FD} = alcove:open(Drv, [Child], File, [o_rdonly], 0),
+    {ok, #alcove_stat{type = dt_reg, ino = Ino}} = alcove:fstat(Drv, [Child],
+        FD),
+    ok = alcove:close(Drv, [Child], FD),
+
+    {ok, [#alcove_stat{type = dt_reg, ino = Ino},
+          {error, enoent},
+          #alcove_stat{type = dt_dir}]} = alcove:stat_many(Drv, [Child],
+        [File, File ++ ".nonexistent", "/tmp"], []),
+
+    % unrequested fields may be undefined if statx(2) is supported
+    {ok, [#alcove_stat{type = dt_reg, size = 3}]} = alcove:stat_many(Drv,
+        [Child], [File], [type, size]),
+    {'EXIT',{badarg,_}} = (catch alcove:stat_many(Drv, [Child], [File],
+            [invalid])),
+
+    % returned in batches
+    {ok, Batch} = alcove:stat_many(Drv, [Child],
+        lists:duplicate(2000, File), [type]),
+    2000 = length(Batch),
+    true = lists:all(fun(#alcove_stat{type = T}) -> T =:= dt_reg end, Batch),
+
+    ok = alcove:unlink(Drv, [Child], Link),
+    ok = alcove:unlink(Drv, [Child], File).
+
+copy_file_range(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+
+    Src = "/tmp/alcove_copy_file_range." ++ integer_to_list(Child),
+    Dst = Src ++ ".copy",
+    Data = binary:copy(<<"0123456789">>, 100000),
+    {ok, 1000000} = alcove:writefile(Drv, [Child], Src, Data,
+        [o_creat, o_trunc]),
+    ok = alcove:chmod(Drv, [Child], Src, 8#640),
+
+    % copied in the process
+    {ok, 1000000} = alcove:copyfile(Drv, [Child], Src, Dst,
+        [o_creat, o_trunc]),
+    {ok, Data} = alcove:readfile(Drv, [Child], Dst, 1000000),
+    {ok, #alcove_stat{mode = 8#640}} = alcove:stat(Drv, [Child], Dst),
+    {error, eexist} = alcove:copyfile(Drv, [Child], Src, Dst,
+        [o_creat, o_excl]),
+    {error, enoent} = alcove:copyfile(Drv, [Child], Src ++ ".nonexistent",
+        Dst, [o_creat]),
+
+    {ok, In} = alcove:open(Drv, [Child], Src, [o_rdonly], 0),
+    {ok, Out} = alcove:open(Drv, [Child], Dst, [o_rdwr, o_trunc], 0),
+
+    % offsets: the file offsets are not changed
+    {ok, 4} = alcove:copy_file_range(Drv, [Child], In, 2, Out, 0, 4),
+    {ok, <<"2345">>} = alcove:pread(Drv, [Child], Out, 1024, 0),
+
+    % file offsets
+    {ok, 5} = alcove:copy_file_range(Drv, [Child], In, -1, Out, -1, 5),
+    {ok, 5} = alcove:sendfile(Drv, [Child], Out, In, -1, 5),
+    {ok, 3} = alcove:sendfile(Drv, [Child], Out, In, 7, 3),
+    {ok, <<"0123456789789">>} = alcove:pread(Drv, [Child], Out, 1024, 0),
+
+    % end of file
+    ok = alcove:lseek(Drv, [Child], In, 0, 2),
+    {ok, 0} = alcove:copy_file_range(Drv, [Child], In, -1, Out, -1, 5),
+
+    {'EXIT',{badarg,_}} = (catch alcove:copy_file_range(Drv, [Child],
+            In, -2, Out, -1, 5)),
+
+    case os:type() of
+        {unix, linux} ->
+            % one of the descriptors must be a pipe
+            {error, einval} = alcove:splice(Drv, [Child], In, 0, Out, 0, 5,
+                [splice_f_move]);
+        _ ->
+            ok
+    end,
+
+    ok = alcove:close(Drv, [Child], In),
+    ok = alcove:close(Drv, [Child], Out),
+    ok = alcove:unlink(Drv, [Child], Src),
+    ok = alcove:unlink(Drv, [Child], Dst).
+
+fork_stdio(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+
+    File = "/tmp/alcove_fork_stdio." ++ integer_to_list(Child),
+    {ok, FD} = alcove:open(Drv, [Child], File,
+        [o_wronly, o_creat, o_trunc], 8#600),
+
+    % stdout is written to the file
+    {ok, Echo} = alcove:fork_stdio(Drv, [Child], [{stdout, FD}]),
+    % replies are returned before exec
+    true = is_integer(alcove:getpid(Drv, [Child, Echo])),
+    ok = alcove:execvp(Drv, [Child, Echo], "/bin/echo",
+        ["/bin/echo", "test"]),
+    {exit_status, 0} = alcove:event(Drv, [Child, Echo], 5000),
+    false = alcove:stdout(Drv, [Child, Echo], 0),
+    {ok, <<"test\n">>} = alcove:readfile(Drv, [Child], File, 1024),
+
+    % stdout is connected to the stdin of another child
+    {ok, Cat} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Cat], "/bin/cat", ["/bin/cat"]),
+    {ok, Pipe} = alcove:fork_stdio(Drv, [Child], [{stdout, {stdin, Cat}}]),
+    ok = alcove:execvp(Drv, [Child, Pipe], "/bin/echo",
+        ["/bin/echo", "pipe"]),
+    {exit_status, 0} = alcove:event(Drv, [Child, Pipe], 5000),
+    <<"pipe\n">> = alcove:stdout(Drv, [Child, Cat], 5000),
+    ok = alcove:eof(Drv, [Child, Cat]),
+    {exit_status, 0} = alcove:event(Drv, [Child, Cat], 5000),
+
+    {error, ebadf} = alcove:fork_stdio(Drv, [Child], [{stdout, 1000}]),
+    {error, esrch} = alcove:fork_stdio(Drv, [Child],
+        [{stdout, {stdin, 1}}]),
+    {'EXIT',{badarg,_}} = (catch alcove:fork_stdio(Drv, [Child],
+            [{stdio, FD}])),
+
+    ok = alcove:close(Drv, [Child], FD),
+    ok = alcove:unlink(Drv, [Child], File).
+
+bridge(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, NC} = alcove:fork(Drv, []),
+    {ok, Child} = alcove:fork(Drv, []),
+
+    Sockname = <<"/tmp/alcove_bridge.",
+                 (integer_to_binary(alcove:getpid(Drv, [])))/binary>>,
+    ok = alcove:execvp(Drv, [NC], "nc", ["nc", "-l", "-U", Sockname]),
+
+    ok = waitfor(Sockname),
+
+    {ok, Socket} = alcove:socket(Drv, [Child], af_unix, sock_stream, 0),
+
+    AF_UNIX = 1,
+    SocknameLen = byte_size(Sockname),
+    Len = (unix_path_max() - SocknameLen) * 8,
+    ok = alcove:connect(Drv, [Child], Socket, [
+                                          sockaddr_common(AF_UNIX, SocknameLen),
+                                          Sockname,
+                                          <<0:Len>>
+                                         ]),
+
+    % nc -> socket -> cat -> socket -> nc
+    {ok, Cat} = alcove:fork(Drv, [Child]),
+    ok = alcove:bridge(Drv, [Child], Cat, Socket),
+    {error, ebusy} = alcove:bridge(Drv, [Child], Cat, Socket),
+    {error, esrch} = alcove:bridge(Drv, [Child], 1, Socket),
+    ok = alcove:execvp(Drv, [Child, Cat], "/bin/cat", ["/bin/cat"]),
+
+    ok = alcove:stdin(Drv, [NC], <<"bridge\n">>),
+    <<"bridge\n">> = alcove:stdout(Drv, [NC], 5000),
+
+    % the socket is closed by the peer: cat reads EOF
+    ok = alcove:kill(Drv, [], NC, 9),
+    Events = [alcove:event(Drv, [Child, Cat], 5000),
+              alcove:event(Drv, [Child, Cat], 5000)],
+    true = lists:member({bridge_closed, 7, 7}, Events),
+    true = lists:member({exit_status, 0}, Events),
+    false = alcove:stdout(Drv, [Child, Cat], 0),
+
+    _ = file:delete(Sockname),
+    ok.
+
+offload(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+    0 = alcove:getopt(Drv, [Child], offload),
+    true = alcove:setopt(Drv, [Child], offload, 1),
+    1 = alcove:getopt(Drv, [Child], offload),
+
+    % output of a child is forwarded while the call is blocked
+    {ok, Sh} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Sh], "/bin/sh",
+        ["/bin/sh", "-c", "echo offload"]),
+    {ok, [], [], []} = alcove:select(Drv, [Child], [], [], [],
+        #alcove_timeval{sec = 0, usec = 200000}),
+    <<"offload\n">> = alcove:stdout(Drv, [Child, Sh], 5000),
+
+    {ok, FD} = alcove:open(Drv, [Child], "/dev/zero", [o_rdonly], 0),
+    {ok, <<0,0,0,0>>} = alcove:read(Drv, [Child], FD, 4),
+    ok = alcove:close(Drv, [Child], FD),
+
+    % opening a fifo blocks until the fifo is opened for writing: calls
+    % to other processes and their output are forwarded in the meantime
+    Fifo = "/tmp/alcove-offload." ++ os:getpid(),
+    ok = alcove:mkfifo(Drv, [Child], Fifo, 8#600),
+    {ok, Other} = alcove:fork(Drv, [Child]),
+    {ok, Echo} = alcove:fork(Drv, [Child]),
+
+    ok = alcove_drv:send(Drv, alcove_codec:call(open, [Child],
+            [Fifo, [o_rdonly], 0])),
+    timeout = receive
+        {alcove_call, Drv, [Child], Reply0} ->
+            Reply0
+    after
+        200 ->
+            timeout
+    end,
+
+    Other = alcove:getpid(Drv, [Child, Other]),
+    ok = alcove:execvp(Drv, [Child, Echo], "/bin/sh",
+        ["/bin/sh", "-c", "echo blocked"]),
+    <<"blocked\n">> = alcove:stdout(Drv, [Child, Echo], 5000),
+
+    % the open returns when the writer opens the fifo
+    {ok, WFD} = alcove:open(Drv, [Child, Other], Fifo, [o_wronly], 0),
+    {ok, RFD} = receive
+        {alcove_call, Drv, [Child], Reply} ->
+            Reply
+    after
+        5000 ->
+            timeout
+    end,
+    ok = alcove:close(Drv, [Child], RFD),
+    ok = alcove:close(Drv, [Child, Other], WFD),
+    ok = alcove:unlink(Drv, [Child], Fifo),
+
+    % waitpid blocks until the child exits: the output of other children
+    % is forwarded in the meantime
+    {ok, Sleep} = alcove:fork(Drv, [Child]),
+    {ok, Waiting} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Sleep], "/bin/sh",
+        ["/bin/sh", "-c", "sleep 1"]),
+    ok = alcove_drv:send(Drv, alcove_codec:call(waitpid, [Child],
+            [Sleep, 0])),
+    ok = alcove:execvp(Drv, [Child, Waiting], "/bin/sh",
+        ["/bin/sh", "-c", "echo waitpid"]),
+    <<"waitpid\n">> = alcove:stdout(Drv, [Child, Waiting], 5000),
+    {ok, Sleep, _, [{exit_status, 0}]} = receive
+        {alcove_call, Drv, [Child], Reply1} ->
+            Reply1
+    after
+        5000 ->
+            timeout
+    end,
+    false = lists:keymember(Sleep, #alcove_pid.pid,
+        alcove:children(Drv, [Child])),
+
+    % the option is inherited: the worker is started in the child
+    {ok, Fork} = alcove:fork(Drv, [Child]),
+    1 = alcove:getopt(Drv, [Child, Fork], offload),
+    {ok, FD1} = alcove:open(Drv, [Child, Fork], "/dev/zero", [o_rdonly], 0),
+    {ok, <<0,0>>} = alcove:read(Drv, [Child, Fork], FD1, 2),
+    ok = alcove:close(Drv, [Child, Fork], FD1).
+
+watch(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+    {ok, FD} = alcove:open(Drv, [Child], "/dev/zero", [o_rdonly], 0),
+
+    % oneshot: removed after the first event
+    ok = alcove:watch(Drv, [Child], FD, [read], []),
+    {fd_ready, FD, [read]} = alcove:event(Drv, [Child], 5000),
+    false = alcove:event(Drv, [Child], 100),
+
+    % persistent: re-armed by the next call, removed by unwatch
+    ok = alcove:watch(Drv, [Child], FD, [read], [persistent]),
+    {fd_ready, FD, [read]} = alcove:event(Drv, [Child], 5000),
+    false = alcove:event(Drv, [Child], 100),
+    {ok, _} = alcove:read(Drv, [Child], FD, 1),
+    {fd_ready, FD, [read]} = alcove:event(Drv, [Child], 5000),
+    ok = alcove:unwatch(Drv, [Child], FD),
+    ok = flush_events(Drv, [Child]),
+
+    % close removes the watch
+    ok = alcove:watch(Drv, [Child], FD, [read], [persistent]),
+    ok = alcove:close(Drv, [Child], FD),
+    ok = flush_events(Drv, [Child]),
+
+    {error, ebusy} = alcove:watch(Drv, [Child], 0, [read], []),
+    {error, ebadf} = alcove:watch(Drv, [Child], FD, [read], []),
+    {'EXIT',{badarg,_}} = (catch alcove:watch(Drv, [Child], 0, [poll], [])).
+
+timer(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+
+    {ok, Id} = alcove:timer_start(Drv, [Child], 10, 0),
+    {timer, Id} = alcove:event(Drv, [Child], 5000),
+    {error, enoent} = alcove:timer_cancel(Drv, [Child], Id),
+
+    {ok, Interval} = alcove:timer_start(Drv, [Child], 10, 10),
+    {timer, Interval} = alcove:event(Drv, [Child], 5000),
+    {timer, Interval} = alcove:event(Drv, [Child], 5000),
+    ok = alcove:timer_cancel(Drv, [Child], Interval),
+    ok = flush_events(Drv, [Child]),
+
+    % the process is killed by the parent
+    {ok, Sleep} = alcove:fork(Drv, [Child]),
+    ok = alcove:set_deadline(Drv, [Child], Sleep, 100, sigkill),
+    ok = alcove:execvp(Drv, [Child, Sleep], "sleep", ["sleep", "60"]),
+    {termsig, sigkill} = alcove:event(Drv, [Child, Sleep], 5000),
+
+    {error, esrch} = alcove:set_deadline(Drv, [Child], 1, 100, sigkill).
+
+read_budget(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+    0 = alcove:getopt(Drv, [Child], read_budget),
+    true = alcove:setopt(Drv, [Child], read_budget, 65536),
+    65536 = alcove:getopt(Drv, [Child], read_budget),
+
+    {ok, Sh} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Sh], "/bin/sh",
+        ["/bin/sh", "-c", "echo stdout; echo stderr 1>&2; sleep 1"]),
+    <<"stdout\n">> = alcove:stdout(Drv, [Child, Sh], 5000),
+    <<"stderr\n">> = alcove:stderr(Drv, [Child, Sh], 5000),
+
+    {ok, Stats} = alcove:child_stats(Drv, [Child], Sh),
+    % includes the replies to calls before exec
+    true = proplists:get_value(stdout, Stats) >= 7,
+    7 = proplists:get_value(stderr, Stats),
+    true = proplists:get_value(reads, Stats) >= 2,
+
+    % a child writing continuously does not delay the other children
+    true = alcove:setopt(Drv, [Child], read_budget, 4096),
+    {ok, Flood} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Flood], "/bin/sh",
+        ["/bin/sh", "-c", "exec head -c 16777216 /dev/zero"]),
+    {ok, Quiet} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Quiet], "/bin/sh",
+        ["/bin/sh", "-c", "echo quiet; sleep 1"]),
+    <<"quiet\n">> = alcove:stdout(Drv, [Child, Quiet], 5000),
+
+    % the flooding child is read at most read_budget bytes per pass
+    {ok, FloodStats} = alcove:child_stats(Drv, [Child], Flood),
+    true = proplists:get_value(stdout, FloodStats) < 16777216,
+    true = proplists:get_value(throttled, FloodStats) > 0,
+    Frames = [alcove:stdout(Drv, [Child, Flood], 5000)
+              || _ <- lists:seq(1, 16)],
+    true = lists:all(fun(Frame) ->
+                    is_binary(Frame) andalso byte_size(Frame) =< 4096
+            end,
+            Frames),
+    _ = alcove:kill(Drv, [Child], Flood, 9),
+
+    {error, esrch} = alcove:child_stats(Drv, [Child], 1).
+
+stdin_queue(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+    true = alcove:setopt(Drv, [Child], stdin_queue, 1024 * 1024),
+
+    % the data is larger than the pipe buffer: cat does not read until
+    % stdout has been drained
+    {ok, Cat} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Cat], "/bin/cat", ["/bin/cat"]),
+
+    Data = binary:copy(<<"x">>, 32768),
+    [ ok = alcove:stdin(Drv, [Child, Cat], Data) || _ <- lists:seq(1, 8) ],
+    ok = alcove:stdin_sync(Drv, [Child, Cat], <<"end">>, 5000),
+
+    % each stdin_sync is replied to when its data has been written
+    [ ok = alcove_drv:send(Drv, alcove_codec:stdin_sync([Child, Cat], Data))
+      || _ <- lists:seq(1, 2) ],
+    [ok, ok] = [ receive
+                     {alcove_pipe, Drv, [Child, Cat], {stdin_sync, Reply}} ->
+                         Reply
+                 after
+                     5000 ->
+                         timeout
+                 end || _ <- lists:seq(1, 2) ],
+
+    ok = alcove:eof(Drv, [Child, Cat]),
+
+    Size = 10 * 32768 + 3,
+    Size = byte_size(read_stdout(Drv, [Child, Cat], <<>>)).
+
+stdin_refused(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+    true = alcove:setopt(Drv, [Child], stdin_queue, 4096),
+
+    % the pipe buffer fills before the process reads stdin
+    {ok, Cat} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Cat], "/bin/sh",
+        ["/bin/sh", "-c", "sleep 1; exec cat >/dev/null"]),
+
+    Data = binary:copy(<<"x">>, 32768),
+    [ ok = alcove:stdin(Drv, [Child, Cat], Data) || _ <- lists:seq(1, 8) ],
+
+    % data over the stdin_queue limit is refused
+    {error, {eagain, Written}} = alcove:stdout(Drv, [Child, Cat], 5000),
+    true = Written < byte_size(Data),
+
+    {ok, Stats} = alcove:stats(Drv, [Child]),
+    true = proplists:get_value(refused, Stats) > 0,
+
+    % a credit is sent when the queue has drained
+    4096 = alcove:stdin_credit(Drv, [Child, Cat], 5000),
+    false = alcove:stdin_credit(Drv, [Child, Cat]).
+
+stdout_flush(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+    0 = alcove:getopt(Drv, [Child], stdout_flush_bytes),
+    true = alcove:setopt(Drv, [Child], stdout_flush_bytes, 10),
+    10 = alcove:getopt(Drv, [Child], stdout_flush_bytes),
+
+    % output is held until the threshold is reached
+    {ok, Bytes} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Bytes], "/bin/sh",
+        ["/bin/sh", "-c", "printf 12345; sleep 0.2; printf 67890; sleep 1"]),
+    <<"1234567890">> = alcove:stdout(Drv, [Child, Bytes], 5000),
+
+    % whole lines are sent at the deadline
+    true = alcove:setopt(Drv, [Child], stdout_flush_bytes, 0),
+    true = alcove:setopt(Drv, [Child], stdout_flush_ms, 50),
+    true = alcove:setopt(Drv, [Child], stdout_lines, 1),
+    1 = alcove:getopt(Drv, [Child], stdout_lines),
+
+    {ok, Lines} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Lines], "/bin/sh",
+        ["/bin/sh", "-c", "printf 'one\\ntw'; sleep 0.2; printf 'o\\nthree'"]),
+    <<"one\n">> = alcove:stdout(Drv, [Child, Lines], 5000),
+    <<"two\n">> = alcove:stdout(Drv, [Child, Lines], 5000),
+    % a partial line is sent when stdout is closed
+    <<"three">> = alcove:stdout(Drv, [Child, Lines], 5000).
+
+compress(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+    0 = alcove:getopt(Drv, [Child], compress),
+    true = alcove:setopt(Drv, [Child], compress, 6),
+    6 = alcove:getopt(Drv, [Child], compress),
+
+    {ok, Sh} = alcove:fork(Drv, [Child]),
+    {ok, Stats0} = alcove:stats(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Sh], "/bin/sh",
+        ["/bin/sh", "-c", "head -c 65536 /dev/zero; echo stderr 1>&2"]),
+    Zero = binary:copy(<<0>>, 65536),
+    Zero = read_stdout(Drv, [Child, Sh], <<>>),
+    <<"stderr\n">> = alcove:stderr(Drv, [Child, Sh], 5000),
+
+    % the output was sent as deflated frames
+    {ok, Stats1} = alcove:stats(Drv, [Child]),
+    true = proplists:get_value(bytes_out, Stats1)
+        - proplists:get_value(bytes_out, Stats0) < 65536 div 4,
+
+    Data = zlib:compress(Zero),
+    Len = 2 + 4 + byte_size(Data),
+    {alcove_stdout, [Child], Zero} = alcove_codec:decode(<<Len:16, 10:16,
+        Child:32, Data/binary>>).
+
+sigevent(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+    {ok, _} = alcove:sigaction(Drv, [Child], sigusr1, sig_info),
+
+    % only the first signal is reported
+    ok = alcove:sigevent(Drv, [Child], sigusr1, [first, nosiginfo]),
+    [ ok = alcove:kill(Drv, [Child], Child, sigusr1) || _ <- lists:seq(1, 3) ],
+    {signal, sigusr1, <<>>} = alcove:event(Drv, [Child], 5000),
+    false = alcove:event(Drv, [Child], 100),
+
+    % signals are counted
+    ok = alcove:sigevent(Drv, [Child], sigusr1, [coalesce]),
+    [ ok = alcove:kill(Drv, [Child], Child, sigusr1) || _ <- lists:seq(1, 3) ],
+    3 = count_signals(Drv, [Child], 0),
+
+    ok = alcove:sigevent(Drv, [Child], sigusr1, [every]),
+    ok = alcove:kill(Drv, [Child], Child, sigusr1),
+    {signal, sigusr1, Info} = alcove:event(Drv, [Child], 5000),
+    true = byte_size(Info) > 0.
+
+exit_rusage(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+    true = alcove:setopt(Drv, [Child], exit_rusage, 1),
+    1 = alcove:getopt(Drv, [Child], exit_rusage),
+
+    {ok, Sh} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Sh], "/bin/sh", ["/bin/sh", "-c", "exit 3"]),
+    {exit_status, 3, Rusage} = alcove:event(Drv, [Child, Sh], 5000),
+    true = is_integer(proplists:get_value(utime, Rusage)),
+    true = is_integer(proplists:get_value(maxrss, Rusage)),
+
+    % exits are reported by the parent
+    true = alcove:setopt(Drv, [Child], exit_batch, 1),
+    {ok, Exit} = alcove:fork(Drv, [Child]),
+    {ok, Kill} = alcove:fork(Drv, [Child]),
+    ok = alcove:exit(Drv, [Child, Exit], 1),
+    ok = alcove:kill(Drv, [Child], Kill, sigkill),
+    Exited = collect_exited(Drv, [Child], []),
+    {Exit, {exit_status, 1}, [_|_]} = lists:keyfind(Exit, 1, Exited),
+    {Kill, {termsig, sigkill}, [_|_]} = lists:keyfind(Kill, 1, Exited),
+    false = alcove:event(Drv, [Child, Exit], 100).
+
+stats(Config) ->
+    Drv = ?config(drv, Config),
+
+    {ok, Child} = alcove:fork(Drv, []),
+    {ok, Child1} = alcove:fork(Drv, [Child]),
+    {error, enoent} = alcove:chdir(Drv, [Child], "/nonexistent"),
+    _ = alcove:getpid(Drv, [Child]),
+
+    % output is held until the deadline
+    true = alcove:setopt(Drv, [Child], stdout_flush_bytes, 1024),
+    true = alcove:setopt(Drv, [Child], stdout_flush_ms, 100),
+    {ok, Cat} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Cat], "/bin/cat", ["/bin/cat"]),
+    ok = alcove:stdin(Drv, [Child, Cat], <<"hello">>),
+    <<"hello">> = alcove:stdout(Drv, [Child, Cat], 5000),
+
+    % the pipe buffer fills before the process reads stdin
+    true = alcove:setopt(Drv, [Child], stdin_queue, 40000),
+    {ok, Sleep} = alcove:fork(Drv, [Child]),
+    ok = alcove:execvp(Drv, [Child, Sleep], "/bin/sh",
+        ["/bin/sh", "-c", "sleep 1; exec cat >/dev/null"]),
+    Data = binary:copy(<<"x">>, 32768),
+    [ ok = alcove:stdin(Drv, [Child, Sleep], Data) || _ <- lists:seq(1, 8) ],
+    {error, {eagain, _}} = alcove:stdout(Drv, [Child, Sleep], 5000),
+
+    {ok, Stats} = alcove:stats(Drv, [Child]),
+    true = proplists:get_value(iterations, Stats) > 0,
+    true = proplists:get_value(frames_in, Stats) >= 3,
+    true = proplists:get_value(bytes_in, Stats) > 8 * 32768,
+    true = proplists:get_value(frames_out, Stats) > 0,
+    true = proplists:get_value(bytes_out, Stats) > 0,
+    true = proplists:get_value(errors, Stats) >= 1,
+    true = proplists:get_value(eagain, Stats) > 0,
+    true = proplists:get_value(refused, Stats) > 0,
+    true = proplists:get_value(stdin_queue_hwm, Stats) > 0,
+    true = proplists:get_value(stdout_buffer_hwm, Stats) >= 5,
+    Calls = proplists:get_value(calls, Stats),
+    1 = proplists:get_value(chdir, Calls),
+    1 = proplists:get_value(getpid, Calls),
+    Children = proplists:get_value(children, Stats),
+    [{stdin, 5}, {stdout, 5}, {stderr, 0}] =
+        proplists:get_value(Cat, Children),
+    [{stdin, In}, {stdout, 0}, {stderr, 0}] =
+        proplists:get_value(Sleep, Children),
+    true = In > 0,
+    [{stdin, _}, {stdout, _}, {stderr, _}] =
+        proplists:get_value(Child1, Children),
+
+    % counters of forked children
+    [{Child1, {ok, Stats1}}] = proplists:get_value(descendants, Stats),
+    [] = proplists:get_value(children, Stats1),
+    [] = proplists:get_value(descendants, Stats1).
+
+collect_exited(_Drv, _Pids, Acc) when length(Acc) >= 2 ->
+    Acc;
+collect_exited(Drv, Pids, Acc) ->
+    {exited, Exited} = alcove:event(Drv, Pids, 5000),
+    collect_exited(Drv, Pids, Exited ++ Acc).
+
+count_signals(Drv, Pids, N) ->
+    case alcove:event(Drv, Pids, 100) of
+        false -> N;
+        {signal, sigusr1, _, Count} -> count_signals(Drv, Pids, N + Count)
+    end.
+
+read_stdout(Drv, Pids, Acc) ->
+    case alcove:stdout(Drv, Pids, 1000) of
+        false -> Acc;
+        Data -> read_stdout(Drv, Pids, <<Acc/binary, Data/binary>>)
+    end.
+
+flush_events(Drv, Pids) ->
+    case alcove:event(Drv, Pids, 100) of
+        false -> ok;
+        {fd_ready, _, _} -> flush_events(Drv, Pids);
+        {timer, _} -> flush_events(Drv, Pids)
+    end.
+
+rss(Drv, Pid) ->
+    {ok, FD} = alcove:open(Drv, [Pid], "/proc/self/statm", [o_rdonly], 0),
+    {ok, Buf} = alcove:read(Drv, [Pid], FD, 1024),
+    ok = alcove:close(Drv, [Pid], FD),
+    [_Size, Resident|_] = string:tokens(binary_to_list(Buf), " \n"),
+    list_to_integer(Resident).
+
 %%
 %% Portability
 %%
@@ -0,0 +1,177 @@
+%%% Copyright (c) 2017, Michael Santos <michael.santos@gmail.com>
+%%%
+%%% Permission to use, copy, modify, and/or distribute this software for any
+%%% purpose with or without fee is hereby granted, provided that the above
+%%% copyright notice and this permission notice appear in all copies.
+%%%
+%%% THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+%%% WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+%%% MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+%%% ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+%%% WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+%%% ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+%%% OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+-module(alcove_bench_SUITE).
+
+%%
+%% Microbenchmarks for the call path: each test runs a call in a loop
+%% and reports the number of calls per second.
+%%
+%% The suite is skipped unless ALCOVE_BENCH is set:
+%%
+%% export ALCOVE_BENCH=1
+%% export ALCOVE_BENCH_COUNT=100000
+%% export ALCOVE_BENCH_RATIO=0.9
+%%
+
+-include_lib("common_test/include/ct.hrl").
+
+-export([
+        suite/0,
+        all/0,
+        init_per_suite/1,
+        end_per_suite/1,
+        init_per_testcase/2,
+        end_per_testcase/2
+    ]).
+-export([
+        getpid/1,
+        kill/1,
+        lseek/1,
+        read/1,
+        write/1,
+        open_flags/1,
+        syscall_constant/1,
+        typed_decode/1
+    ]).
+
+suite() ->
+    [{timetrap, {minutes, 5}}].
+
+all() ->
+    [getpid, kill, lseek, read, write, open_flags, syscall_constant,
+        typed_decode].
+
+init_per_suite(Config) ->
+    case os:getenv("ALCOVE_BENCH") of
+        false ->
+            {skip, "set ALCOVE_BENCH to run the benchmarks"};
+        _ ->
+            Config
+    end.
+
+end_per_suite(Config) ->
+    Config.
+
+init_per_testcase(_Test, Config) ->
+    {ok, Drv} = alcove_drv:start_link([]),
+    {ok, Child} = alcove:fork(Drv, []),
+    {ok, FD} = alcove:open(Drv, [Child], "/dev/zero", [o_rdwr], 0),
+    [{drv, Drv},
+        {child, Child},
+        {fd, FD},
+        {count, list_to_integer(os:getenv("ALCOVE_BENCH_COUNT", "10000"))}|Config].
+
+end_per_testcase(_Test, Config) ->
+    Drv = ?config(drv, Config),
+    alcove_drv:stop(Drv).
+
+%%
+%% Tests
+%%
+getpid(Config) ->
+    Drv = ?config(drv, Config),
+    Child = ?config(child, Config),
+    bench(getpid, Config, fun() -> alcove:getpid(Drv, [Child]) end).
+
+kill(Config) ->
+    Drv = ?config(drv, Config),
+    Child = ?config(child, Config),
+    bench(kill, Config, fun() -> ok = alcove:kill(Drv, [Child], Child, 0) end).
+
+lseek(Config) ->
+    Drv = ?config(drv, Config),
+    Child = ?config(child, Config),
+    FD = ?config(fd, Config),
+    bench(lseek, Config, fun() -> ok = alcove:lseek(Drv, [Child], FD, 0, 0) end).
+
+read(Config) ->
+    Drv = ?config(drv, Config),
+    Child = ?config(child, Config),
+    FD = ?config(fd, Config),
+    bench(read, Config, fun() -> {ok, _} = alcove:read(Drv, [Child], FD, 1024) end).
+
+write(Config) ->
+    Drv = ?config(drv, Config),
+    Child = ?config(child, Config),
+    FD = ?config(fd, Config),
+    Data = binary:copy(<<0>>, 1024),
+    bench(write, Config, fun() -> {ok, 1024} = alcove:write(Drv, [Child], FD, Data) end).
+
+% constant lookups: each flag is looked up by name
+open_flags(Config) ->
+    Drv = ?config(drv, Config),
+    Child = ?config(child, Config),
+    bench(open_flags, Config, fun() ->
+                {ok, FD} = alcove:open(Drv, [Child], "/dev/null",
+                    [o_rdonly, o_cloexec, o_nonblock, o_noctty], 0),
+                ok = alcove:close(Drv, [Child], FD)
+        end).
+
+% the syscall table is the largest constant table: look up an entry
+% at the end of the table
+syscall_constant(Config) ->
+    Drv = ?config(drv, Config),
+    Child = ?config(child, Config),
+    case os:type() of
+        {unix, linux} ->
+            bench(syscall_constant, Config, fun() ->
+                        true = is_integer(alcove:syscall_constant(Drv,
+                                    [Child], audit_arch_x86_64))
+                end);
+        _ ->
+            {skip, "syscall constants are only supported on linux"}
+    end.
+
+% Compare a call dispatched through a generated decoder with a call
+% decoded by hand through the generic ETF path, in the same run: kill/2
+% (int, constant:signal) and getpriority/2 (constant, constant) take two
+% small integers and make a syscall with no side effects.
+typed_decode(Config) ->
+    Drv = ?config(drv, Config),
+    Child = ?config(child, Config),
+    Ratio = list_to_float(os:getenv("ALCOVE_BENCH_RATIO", "0.9")),
+    % PRIO_PROCESS
+    PrioProcess = 0,
+    Generic = rate(getpriority, Config, fun() ->
+                {ok, _} = alcove:getpriority(Drv, [Child], PrioProcess, 0)
+        end),
+    Typed = rate(kill, Config, fun() ->
+                ok = alcove:kill(Drv, [Child], Child, 0)
+        end),
+    ct:pal("typed/generic: ~.2f", [Typed / Generic]),
+    true = Typed / Generic >= Ratio,
+    {comment, io_lib:format("typed ~p calls/s, generic ~p calls/s",
+            [Typed, Generic])}.
+
+%%
+%% Internal functions
+%%
+bench(Name, Config, Fun) ->
+    Rate = rate(Name, Config, Fun),
+    {comment, io_lib:format("~p calls/s", [Rate])}.
+
+rate(Name, Config, Fun) ->
+    N = ?config(count, Config),
+    % warm up
+    loop(Fun, 100),
+    {Usec, ok} = timer:tc(fun() -> loop(Fun, N) end),
+    Rate = N * 1000000 div max(Usec, 1),
+    ct:pal("~p: ~p calls in ~p us (~p calls/s)", [Name, N, Usec, Rate]),
+    Rate.
+
+loop(_Fun, 0) ->
+    ok;
+loop(Fun, N) ->
+    _ = Fun(),
+    loop(Fun, N-1).
@@ -20,11 +20,12 @@
         all/0
     ]).
 -export([
-        decode/1
+        decode/1,
+        rawcall/1
     ]).
 
 all() ->
-    [decode].
+    [decode, rawcall].
 
 %%
 %% Tests
@@ -40,3 +41,28 @@ decode(_Config) ->
         >>,
 
     {alcove_call,[295,551,807],<<"0.2.0">>} = alcove_codec:decode(Msg).
+
+rawcall(_Config) ->
+    % Length, Message type, Call, Arguments
+    <<0,11, 0,8, _:2/bytes, 3:32/native-signed, "abc">> =
+        iolist_to_binary(alcove_codec:call(write, [], [3, <<"abc">>])),
+    <<0,11, 0,8, _:2/bytes, 3:32/native-signed, "abc">> =
+        iolist_to_binary(alcove_codec:call(write, [], [3, ["a", <<"b">>, $c]])),
+    <<0,16, 0,8, _:2/bytes, 3:32/native-signed, 1024:64/native-unsigned>> =
+        iolist_to_binary(alcove_codec:call(read, [], [3, 1024])),
+
+    % Arguments not matching the layout are sent in external term format
+    <<_:2/bytes, 0,4, _/binary>> =
+        iolist_to_binary(alcove_codec:call(write, [], [3, [256]])),
+    <<_:2/bytes, 0,4, _/binary>> =
+        iolist_to_binary(alcove_codec:call(read, [], [3, -1])),
+
+    % Replies
+    {alcove_call, [], {ok, <<"abc">>}} =
+        alcove_codec:decode(<<0,6, 0,8, 2, "abc">>),
+    {alcove_call, [], {ok, 1024}} =
+        alcove_codec:decode(<<0,11, 0,8, 1, 1024:64/native-signed>>),
+    {alcove_call, [], {error, ebadf}} =
+        alcove_codec:decode(<<0,8, 0,8, 3, "ebadf">>),
+    {alcove_call, [295], badarg} =
+        alcove_codec:decode(<<0,17, 0,3, 0,0,1,39, 0,9, 0,8, 0, "badarg">>).